@@ -0,0 +1,437 @@
+#include "AABBTree.h"
+#include <cmath>
+#include <functional>
+
+static bool SegmentHitsBox(const Bounds& b, float x, float y, float dx, float dy, float maxT, float& t) {
+    float tMin = 0.0f, tMax = maxT;
+    const float p[2] = { x, y }, d[2] = { dx, dy };
+    const float lo[2] = { b.minX, b.minY }, hi[2] = { b.maxX, b.maxY };
+
+    for (int i = 0; i < 2; ++i) {
+        if (std::abs(d[i]) < 1e-9f) {
+            if (p[i] < lo[i] || p[i] > hi[i])
+                return false;
+            continue;
+        }
+        float t1 = (lo[i] - p[i]) / d[i];
+        float t2 = (hi[i] - p[i]) / d[i];
+        if (t1 > t2)
+            std::swap(t1, t2);
+        tMin = std::max(tMin, t1);
+        tMax = std::min(tMax, t2);
+        if (tMin > tMax)
+            return false;
+    }
+    t = tMin;
+    return true;
+}
+
+static bool SegmentHitsCircle(float cx, float cy, float r, float x, float y, float dx, float dy, float maxT, float& t) {
+    float fx = x - cx, fy = y - cy;
+    float c = fx * fx + fy * fy - r * r;
+    if (c <= 0.0f) {
+        t = 0.0f;
+        return true;
+    }
+
+    float a = dx * dx + dy * dy;
+    float b = 2.0f * (fx * dx + fy * dy);
+    float disc = b * b - 4.0f * a * c;
+    if (a == 0.0f || disc < 0.0f)
+        return false;
+
+    t = (-b - std::sqrt(disc)) / (2.0f * a);
+    return t >= 0.0f && t <= maxT;
+}
+
+int AABBTree::allocateNode() {
+    int node;
+    if (freeList == nullProxy) {
+        node = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+    } else {
+        node = freeList;
+        freeList = nodes[node].parent;
+    }
+
+    Node& n = nodes[node];
+    n.parent = n.child1 = n.child2 = nullProxy;
+    n.height = 0;
+    n.entity = nullptr;
+    n.shape = ProxyShape::Rect;
+    return node;
+}
+
+void AABBTree::freeNode(int node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+void AABBTree::refit(int node) {
+    Node& n = nodes[node];
+    n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+    n.box = Bounds::merge(nodes[n.child1].box, nodes[n.child2].box);
+}
+
+void AABBTree::insertLeaf(int leaf) {
+    if (root == nullProxy) {
+        root = leaf;
+        nodes[root].parent = nullProxy;
+        return;
+    }
+
+    // Descend to the sibling that increases the total perimeter of the tree the least.
+    Bounds leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        int child1 = nodes[index].child1, child2 = nodes[index].child2;
+
+        float area = nodes[index].box.perimeter();
+        float combinedArea = Bounds::merge(nodes[index].box, leafBox).perimeter();
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            float merged = Bounds::merge(leafBox, nodes[child].box).perimeter();
+            return (nodes[child].isLeaf() ? merged : merged - nodes[child].box.perimeter()) + inheritance;
+        };
+        float cost1 = descendCost(child1);
+        float cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? child1 : child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = Bounds::merge(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == nullProxy)
+        root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+        nodes[oldParent].child1 = newParent;
+    else
+        nodes[oldParent].child2 = newParent;
+
+    for (index = nodes[leaf].parent; index != nullProxy; index = nodes[index].parent) {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+void AABBTree::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = nullProxy;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == nullProxy) {
+        root = sibling;
+        nodes[sibling].parent = nullProxy;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    for (int index = grandParent; index != nullProxy; index = nodes[index].parent) {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+int AABBTree::balance(int iA) {
+    if (nodes[iA].isLeaf() || nodes[iA].height < 2)
+        return iA;
+
+    int iB = nodes[iA].child1, iC = nodes[iA].child2;
+    int difference = nodes[iC].height - nodes[iB].height;
+    if (difference >= -1 && difference <= 1)
+        return iA;
+
+    // Rotate the higher child up. "up" is the child that takes the place of A, "other" is A's remaining child.
+    int up = difference > 1 ? iC : iB;
+    int other = difference > 1 ? iB : iC;
+    int iF = nodes[up].child1, iG = nodes[up].child2;
+
+    nodes[up].child1 = iA;
+    nodes[up].parent = nodes[iA].parent;
+    nodes[iA].parent = up;
+
+    int upParent = nodes[up].parent;
+    if (upParent == nullProxy)
+        root = up;
+    else if (nodes[upParent].child1 == iA)
+        nodes[upParent].child1 = up;
+    else
+        nodes[upParent].child2 = up;
+
+    int keep = nodes[iF].height > nodes[iG].height ? iF : iG;
+    int give = keep == iF ? iG : iF;
+
+    nodes[up].child2 = keep;
+    if (up == iC)
+        nodes[iA].child2 = give;
+    else
+        nodes[iA].child1 = give;
+    nodes[give].parent = iA;
+
+    nodes[iA].box = Bounds::merge(nodes[other].box, nodes[give].box);
+    nodes[iA].height = 1 + std::max(nodes[other].height, nodes[give].height);
+    nodes[up].box = Bounds::merge(nodes[iA].box, nodes[keep].box);
+    nodes[up].height = 1 + std::max(nodes[iA].height, nodes[keep].height);
+
+    return up;
+}
+
+ProxyID AABBTree::insertProxy(Entity* entity, const Bounds& bounds, ProxyShape shape) {
+    int proxy = allocateNode();
+    Node& n = nodes[proxy];
+    n.tight = bounds;
+    n.box = { bounds.minX - margin, bounds.minY - margin, bounds.maxX + margin, bounds.maxY + margin };
+    n.entity = entity;
+    n.shape = shape;
+    n.slot = proxies.size();
+
+    proxies.push_back(proxy);
+    insertLeaf(proxy);
+    return proxy;
+}
+
+ProxyID AABBTree::createProxy(Entity* entity, const SDL_Rect* rect) {
+    ProxyID proxy = insertProxy(entity, Bounds::ofRect(*rect), ProxyShape::Rect);
+    nodes[proxy].rect = rect;
+    nodes[proxy].center = nullptr;
+    nodes[proxy].radius = nullptr;
+    return proxy;
+}
+
+ProxyID AABBTree::createProxy(Entity* entity, const Vector2D* center, const float* radius) {
+    ProxyID proxy = insertProxy(entity, Bounds::ofCircle(center->x, center->y, *radius), ProxyShape::Circle);
+    nodes[proxy].rect = nullptr;
+    nodes[proxy].center = center;
+    nodes[proxy].radius = radius;
+    return proxy;
+}
+
+void AABBTree::destroyProxy(ProxyID proxy) {
+    std::size_t slot = nodes[proxy].slot;
+    proxies[slot] = proxies.back();
+    nodes[proxies[slot]].slot = slot;
+    proxies.pop_back();
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+}
+
+Bounds AABBTree::sourceBounds(const Node& leaf) const {
+    if (leaf.shape == ProxyShape::Rect)
+        return Bounds::ofRect(*leaf.rect);
+    return Bounds::ofCircle(leaf.center->x, leaf.center->y, *leaf.radius);
+}
+
+std::size_t AABBTree::refit() {
+    std::size_t reinserted = 0;
+    for (int proxy : proxies) {
+        Bounds bounds = sourceBounds(nodes[proxy]);
+        nodes[proxy].tight = bounds;
+        if (nodes[proxy].box.contains(bounds))
+            continue;
+
+        removeLeaf(proxy);
+        nodes[proxy].box = { bounds.minX - margin, bounds.minY - margin, bounds.maxX + margin, bounds.maxY + margin };
+        insertLeaf(proxy);
+        ++reinserted;
+    }
+    return reinserted;
+}
+
+bool AABBTree::accepts(const Node& leaf, const GroupBitSet& mask) const {
+    return leaf.entity->isActive() && (leaf.entity->getGroups() & mask).any();
+}
+
+float AABBTree::distanceSquared(const Node& leaf, float x, float y) const {
+    if (leaf.shape == ProxyShape::Rect)
+        return leaf.tight.distanceSquared(x, y);
+
+    float r = (leaf.tight.maxX - leaf.tight.minX) / 2.0f;
+    float dx = x - (leaf.tight.minX + r), dy = y - (leaf.tight.minY + r);
+    float d = std::max(std::sqrt(dx * dx + dy * dy) - r, 0.0f);
+    return d * d;
+}
+
+Entity* AABBTree::raycast(float x1, float y1, float x2, float y2, const GroupBitSet& mask, float* fraction) const {
+    float dx = x2 - x1, dy = y2 - y1;
+    float best = 1.0f;
+    Entity* hit = nullptr;
+
+    stack.clear();
+    if (root != nullProxy)
+        stack.push_back(root);
+
+    while (!stack.empty()) {
+        const Node& n = nodes[stack.back()];
+        stack.pop_back();
+
+        float t;
+        if (!SegmentHitsBox(n.box, x1, y1, dx, dy, best, t))
+            continue;
+
+        if (!n.isLeaf()) {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+            continue;
+        }
+
+        if (!accepts(n, mask))
+            continue;
+
+        bool exact;
+        if (n.shape == ProxyShape::Rect) {
+            exact = SegmentHitsBox(n.tight, x1, y1, dx, dy, best, t);
+        } else {
+            float r = (n.tight.maxX - n.tight.minX) / 2.0f;
+            exact = SegmentHitsCircle(n.tight.minX + r, n.tight.minY + r, r, x1, y1, dx, dy, best, t);
+        }
+
+        if (exact && t <= best) {
+            best = t;
+            hit = n.entity;
+        }
+    }
+
+    if (hit && fraction)
+        *fraction = best;
+    return hit;
+}
+
+void AABBTree::overlapRect(const SDL_Rect& rect, std::vector<Entity*>& out, const GroupBitSet& mask) const {
+    Bounds query = Bounds::ofRect(rect);
+
+    stack.clear();
+    if (root != nullProxy)
+        stack.push_back(root);
+
+    while (!stack.empty()) {
+        const Node& n = nodes[stack.back()];
+        stack.pop_back();
+
+        if (!n.box.overlaps(query))
+            continue;
+
+        if (!n.isLeaf()) {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+            continue;
+        }
+
+        if (!accepts(n, mask))
+            continue;
+
+        bool exact;
+        if (n.shape == ProxyShape::Rect) {
+            exact = query.minX < n.tight.maxX && n.tight.minX < query.maxX &&
+                query.minY < n.tight.maxY && n.tight.minY < query.maxY;
+        } else {
+            float r = (n.tight.maxX - n.tight.minX) / 2.0f;
+            exact = query.distanceSquared(n.tight.minX + r, n.tight.minY + r) <= r * r;
+        }
+
+        if (exact)
+            out.push_back(n.entity);
+    }
+}
+
+void AABBTree::overlapCircle(float x, float y, float radius, std::vector<Entity*>& out, const GroupBitSet& mask) const {
+    Bounds query = Bounds::ofCircle(x, y, radius);
+
+    stack.clear();
+    if (root != nullProxy)
+        stack.push_back(root);
+
+    while (!stack.empty()) {
+        const Node& n = nodes[stack.back()];
+        stack.pop_back();
+
+        if (!n.box.overlaps(query) || n.box.distanceSquared(x, y) > radius * radius)
+            continue;
+
+        if (!n.isLeaf()) {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+            continue;
+        }
+
+        if (accepts(n, mask) && distanceSquared(n, x, y) <= radius * radius)
+            out.push_back(n.entity);
+    }
+}
+
+void AABBTree::nearest(float x, float y, std::size_t k, std::vector<Entity*>& out, const GroupBitSet& mask, const Entity* exclude) const {
+    if (root == nullProxy || k == 0)
+        return;
+
+    // Best-first search: nodes are visited in the order of their distance, results are kept in a max-heap of size k.
+    auto nodeOrder = std::greater<std::pair<float, int>>();
+    auto resultOrder = [](const std::pair<float, Entity*>& a, const std::pair<float, Entity*>& b) { return a.first < b.first; };
+
+    openNodes.clear();
+    bestEntities.clear();
+    openNodes.emplace_back(nodes[root].box.distanceSquared(x, y), root);
+
+    while (!openNodes.empty()) {
+        std::pop_heap(openNodes.begin(), openNodes.end(), nodeOrder);
+        auto [distance, index] = openNodes.back();
+        openNodes.pop_back();
+
+        if (bestEntities.size() == k && distance > bestEntities.front().first)
+            break;
+
+        const Node& n = nodes[index];
+        if (!n.isLeaf()) {
+            for (int child : { n.child1, n.child2 }) {
+                float d = nodes[child].box.distanceSquared(x, y);
+                if (bestEntities.size() < k || d <= bestEntities.front().first) {
+                    openNodes.emplace_back(d, child);
+                    std::push_heap(openNodes.begin(), openNodes.end(), nodeOrder);
+                }
+            }
+            continue;
+        }
+
+        if (n.entity == exclude || !accepts(n, mask))
+            continue;
+
+        float d = distanceSquared(n, x, y);
+        if (bestEntities.size() < k) {
+            bestEntities.emplace_back(d, n.entity);
+            std::push_heap(bestEntities.begin(), bestEntities.end(), resultOrder);
+        } else if (d < bestEntities.front().first) {
+            std::pop_heap(bestEntities.begin(), bestEntities.end(), resultOrder);
+            bestEntities.back() = { d, n.entity };
+            std::push_heap(bestEntities.begin(), bestEntities.end(), resultOrder);
+        }
+    }
+
+    std::sort_heap(bestEntities.begin(), bestEntities.end(), resultOrder);
+    for (auto& b : bestEntities)
+        out.push_back(b.second);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "ECS.h"
+#include "../Vector2D.h"
+#include "SDL.h"
+#include <vector>
+
+using ProxyID = int;
+
+/// <summary>
+/// Axis-aligned box in world coordinates.
+/// </summary>
+struct Bounds {
+	float minX, minY, maxX, maxY;
+
+	static Bounds ofRect(const SDL_Rect& rect) {
+		return { static_cast<float>(rect.x), static_cast<float>(rect.y),
+			static_cast<float>(rect.x + rect.w), static_cast<float>(rect.y + rect.h) };
+	}
+
+	static Bounds ofCircle(float x, float y, float radius) {
+		return { x - radius, y - radius, x + radius, y + radius };
+	}
+
+	static Bounds merge(const Bounds& a, const Bounds& b) {
+		return { std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+	}
+
+	bool overlaps(const Bounds& b) const {
+		return minX <= b.maxX && b.minX <= maxX && minY <= b.maxY && b.minY <= maxY;
+	}
+
+	bool contains(const Bounds& b) const {
+		return minX <= b.minX && minY <= b.minY && b.maxX <= maxX && b.maxY <= maxY;
+	}
+
+	float perimeter() const {
+		return 2.0f * ((maxX - minX) + (maxY - minY));
+	}
+
+	float distanceSquared(float x, float y) const {
+		float dx = std::max(std::max(minX - x, 0.0f), x - maxX);
+		float dy = std::max(std::max(minY - y, 0.0f), y - maxY);
+		return dx * dx + dy * dy;
+	}
+};
+
+enum class ProxyShape { Rect, Circle };
+
+/// <summary>
+/// Dynamic bounding volume tree over the colliders of a world. Each shape reads its bounds from the component that owns it,
+/// and refit reinserts only the shapes that have left their enlarged boxes. The tree is rebalanced with rotations on insertion.
+/// Queries can be filtered by entity groups. They use scratch memory of the tree, so one tree must not be queried from several threads at once.
+/// </summary>
+class AABBTree {
+public:
+	static constexpr ProxyID nullProxy = -1;
+
+private:
+	struct Node {
+		Bounds box;
+		Bounds tight;
+		int parent;
+		int child1, child2;
+		int height;
+		Entity* entity;
+		ProxyShape shape;
+		std::size_t slot;
+
+		const SDL_Rect* rect;
+		const Vector2D* center;
+		const float* radius;
+
+		bool isLeaf() const { return child1 == nullProxy; }
+	};
+
+	std::vector<Node> nodes;
+	int root = nullProxy;
+	int freeList = nullProxy;
+	std::vector<int> proxies;
+	float margin;
+
+	mutable std::vector<int> stack;
+	mutable std::vector<std::pair<float, int>> openNodes;
+	mutable std::vector<std::pair<float, Entity*>> bestEntities;
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int a);
+	void refit(int node);
+
+	ProxyID insertProxy(Entity* entity, const Bounds& bounds, ProxyShape shape);
+	Bounds sourceBounds(const Node& leaf) const;
+
+	bool accepts(const Node& leaf, const GroupBitSet& mask) const;
+	float distanceSquared(const Node& leaf, float x, float y) const;
+public:
+	/// <summary>
+	/// Creates an empty tree.
+	/// </summary>
+	/// <param name="margin - how far the stored boxes are enlarged on each side, in pixels"></param>
+	AABBTree(float margin = 8.0f) : margin(margin) { }
+
+	/// <summary>
+	/// Adds a rectangle to the tree. The rectangle must stay valid until the shape is destroyed.
+	/// </summary>
+	/// <param name="entity - the entity the shape belongs to"></param>
+	/// <param name="rect - the rectangle in world coordinates, for example ColliderComponent::collider"></param>
+	/// <returns></returns>
+	ProxyID createProxy(Entity* entity, const SDL_Rect* rect);
+
+	/// <summary>
+	/// Adds a circle to the tree. The center and the radius must stay valid until the shape is destroyed.
+	/// </summary>
+	/// <param name="entity - the entity the shape belongs to"></param>
+	/// <param name="center - the center in world coordinates, for example TransformComponent::position"></param>
+	/// <param name="radius - the radius, for example TransformComponent::radius"></param>
+	/// <returns></returns>
+	ProxyID createProxy(Entity* entity, const Vector2D* center, const float* radius);
+
+	void destroyProxy(ProxyID proxy);
+
+	/// <summary>
+	/// Reads the current bounds of all shapes. Only the shapes that have left their enlarged boxes are reinserted.
+	/// </summary>
+	/// <returns>the number of reinserted shapes</returns>
+	std::size_t refit();
+
+	/// <summary>
+	/// Returns the first entity hit by the segment, or nullptr.
+	/// </summary>
+	/// <param name="x1, y1 - the start of the segment"></param>
+	/// <param name="x2, y2 - the end of the segment"></param>
+	/// <param name="mask - only entities in at least one of these groups are hit"></param>
+	/// <param name="fraction - receives the position of the hit along the segment, from 0 to 1 (optional)"></param>
+	/// <returns></returns>
+	Entity* raycast(float x1, float y1, float x2, float y2, const GroupBitSet& mask = GroupBitSet().set(), float* fraction = nullptr) const;
+
+	/// <summary>
+	/// Appends the entities whose shapes overlap the rectangle.
+	/// </summary>
+	void overlapRect(const SDL_Rect& rect, std::vector<Entity*>& out, const GroupBitSet& mask = GroupBitSet().set()) const;
+
+	/// <summary>
+	/// Appends the entities whose shapes overlap the circle.
+	/// </summary>
+	void overlapCircle(float x, float y, float radius, std::vector<Entity*>& out, const GroupBitSet& mask = GroupBitSet().set()) const;
+
+	/// <summary>
+	/// Appends up to k entities closest to the point, nearest first.
+	/// </summary>
+	/// <param name="x, y - the point"></param>
+	/// <param name="k - the maximum number of entities"></param>
+	/// <param name="out - the vector to which the entities are appended"></param>
+	/// <param name="mask - only entities in at least one of these groups are returned"></param>
+	/// <param name="exclude - an entity to skip, usually the one asking (optional)"></param>
+	void nearest(float x, float y, std::size_t k, std::vector<Entity*>& out, const GroupBitSet& mask = GroupBitSet().set(), const Entity* exclude = nullptr) const;
+
+	std::size_t size() const { return proxies.size(); }
+
+	int getHeight() const { return root == nullProxy ? 0 : nodes[root].height; }
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../TextureManager.h"
+#include "Animation.h"
+#include "RenderState.h"
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <mutex>
+#include <cassert>
+
+using AnimationTable = std::pmr::map<const char*, Animation>;
+
+/// <summary>
+/// Textures and animation tables loaded once and shared by all worlds of the process. Assets are never changed or unloaded
+/// while worlds are running, so the returned pointers stay valid for the lifetime of the object.
+/// </summary>
+class Assets {
+private:
+	mutable std::mutex mutex;
+	std::map<std::string, SDL_Texture*> textures;
+	std::map<std::string, AnimationTable> animationTables;
+public:
+	Assets() = default;
+	Assets(const Assets&) = delete;
+	Assets& operator=(const Assets&) = delete;
+
+	~Assets() {
+		for (auto& t : textures)
+			SDL_DestroyTexture(t.second);
+	}
+
+	/// <summary>
+	/// Returns the texture, loading it on the first request. While a RenderThread runs, textures can be loaded only on it,
+	/// so worlds drawn by it should have their textures loaded by the setup function of the thread.
+	/// </summary>
+	/// <param name="path - the path to the texture"></param>
+	/// <returns></returns>
+	SDL_Texture* getTexture(const std::string& path) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = textures.find(path);
+		if (it == textures.end()) {
+			assert(RenderResources::isRendererThread() && "textures must be loaded on the thread that owns the renderer");
+			it = textures.emplace(path, TextureManager::LoadTexture(path.c_str())).first;
+		}
+		return it->second;
+	}
+
+	/// <summary>
+	/// Registers a named animation table.
+	/// </summary>
+	/// <param name="name - table name"></param>
+	/// <param name="table - animations by name"></param>
+	void addAnimationTable(const std::string& name, const AnimationTable& table) {
+		std::lock_guard<std::mutex> lock(mutex);
+		animationTables[name] = table;
+	}
+
+	/// <summary>
+	/// Returns the animation table, or nullptr if there is no table with this name.
+	/// </summary>
+	/// <param name="name - table name"></param>
+	/// <returns></returns>
+	const AnimationTable* getAnimationTable(const std::string& name) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = animationTables.find(name);
+		return it == animationTables.end() ? nullptr : &it->second;
+	}
+};
@@ -2,13 +2,13 @@
 #include "Components.h"
 #include <string>
 #include "../Game.h"
-#include <list>
+#include <vector>
+#include <map>
+#include <memory_resource>
 #include <stdarg.h>
 #include "Collision.h"
 #include <functional>
 
-extern Manager manager;
-
 class Collision;
 
 class ColliderComponent : public Component {
@@ -17,15 +17,22 @@ private:
 	SDL_Texture* tex;
 	SDL_Rect srcRect, dstRect;
 
-	std::list<std::size_t> conflictingGroups;
+	std::pmr::vector<std::size_t> conflictingGroups{ Memory::current() };
 
 	TransformComponent* transform;
+	World* world;
+	ProxyID sceneProxy = AABBTree::nullProxy;
 public:
 	SDL_Rect collider;
-	std::string tag;
+	TagID tag;
 
-	ColliderComponent(std::string tag, bool haveTexture = false) {
-		this->tag = tag;
+	/// <summary>
+	/// Creates a collider. The tag is interned and given to the entity, so the entity can be found with Manager::getTagged.
+	/// </summary>
+	/// <param name="tag - the tag name"></param>
+	/// <param name="haveTexture - true to draw the collider (optional)"></param>
+	ColliderComponent(std::string_view tag, bool haveTexture = false) {
+		this->tag = Tags::intern(tag);
 		this->haveTexture = haveTexture;
 
 		if (this->haveTexture)
@@ -33,15 +40,24 @@ public:
 	}
 
 	void init() override {
-		if (!entity->hasComponent<TransformComponent>())
-			entity->addComponent<TransformComponent>();
+		world = &entity->getManager().getWorld();
 
-		transform = &entity->getComponent<TransformComponent>();
+		transform = &entity->require<TransformComponent>();
+		entity->setTag(tag);
 
 		collider = { static_cast<int>(transform->position.x), static_cast<int>(transform->position.y),
 			(transform->width * transform->scale), (transform->height * transform->scale) };
 		if (haveTexture)
-			dstRect = { collider.x - Game::camera.x, collider.y - Game::camera.y, collider.w, collider.h };
+			dstRect = { collider.x - world->camera.x, collider.y - world->camera.y, collider.w, collider.h };
+
+		if (transform->radius == 0)
+			sceneProxy = world->scene.createProxy(entity, &collider);
+	}
+
+	void onRemove() override {
+		if (sceneProxy != AABBTree::nullProxy)
+			world->scene.destroyProxy(sceneProxy);
+		entity->release<TransformComponent>();
 	}
 
 	void update() override {
@@ -49,7 +65,7 @@ public:
 			(transform->width * transform->scale), (transform->height * transform->scale) };
 		
 		if (haveTexture)
-			dstRect = { collider.x - Game::camera.x, collider.y - Game::camera.y, collider.w, collider.h };
+			dstRect = { collider.x - world->camera.x, collider.y - world->camera.y, collider.w, collider.h };
 	}
 
 	void draw() override {
@@ -57,6 +73,14 @@ public:
 			TextureManager::Draw(tex, srcRect, dstRect, SDL_FLIP_NONE);
 	}
 
+	void publish(RenderSnapshot& snapshot, Group layer) override {
+		if (!haveTexture)
+			return;
+
+		SDL_Rect previous = { static_cast<int>(transform->past_position.x), static_cast<int>(transform->past_position.y), collider.w, collider.h };
+		snapshot.items.push_back({ tex, srcRect, previous, collider, SDL_FLIP_NONE, layer });
+	}
+
 	/// <summary>
 	/// Sets a new texture.
 	/// </summary>
@@ -70,6 +94,14 @@ public:
 		srcRect = { srcX, srcY, width, height };
 	}
 
+	/// <summary>
+	/// Returns the name of the collider's tag.
+	/// </summary>
+	/// <returns></returns>
+	const std::string& getTagName() const {
+		return Tags::name(tag);
+	}
+
 	/// <summary>
 	/// Stops rendering the texture.
 	/// </summary>
@@ -83,7 +115,7 @@ public:
 	/// <param name="am_groups - the number of subsequent parameters"></param>
 	/// <param name="... - any number of entity groups"></param>
 	void setCollisions(int am_groups, ...) {
-		conflictingGroups.resize(am_groups);
+		conflictingGroups.clear();
 		va_list argGroups;
 		va_start(argGroups, am_groups);
 		for (size_t i = 0; i < am_groups; ++i)
@@ -93,16 +125,18 @@ public:
 	
 	/// <summary>
 	/// Checks for collisions between the main entity and entities from the groups specified in the set Collisions function. If a collision has been detected, the function specified in the parameter is called.
+	/// The returned map is allocated in the frame arena and stays valid until the next Manager::refresh.
 	/// </summary>
 	/// <typeparam name="T"></typeparam>
 	/// <param name="func - a function with any type of return value that takes the main entity and a side entity as parameters"></param>
 	/// <param name="write_collision - the value of the bool type, depending on which the collision will be written in the console (optional)"></param>
 	/// <returns></returns>
 	template<typename T>
-	std::map<Entity*, T>& serviceCollisions(std::function<T(Entity* _main, Entity* _side)> func, bool write_collision = false) {
-		std::map<Entity*, T>* _mp = new std::map<Entity*, T>();
+	std::pmr::map<Entity*, T>& serviceCollisions(std::function<T(Entity* _main, Entity* _side)> func, bool write_collision = false) {
+		FrameArena& arena = world->manager.getMemory().getFrame();
+		std::pmr::map<Entity*, T>* _mp = arena.create<std::pmr::map<Entity*, T>>(&arena);
 		for (auto& g : conflictingGroups) {
-			for (auto& e : manager.getGroup(g)) {
+			for (auto& e : world->manager.getGroup(g)) {
 				if (e->hasComponent<ColliderComponent>() && e != this->entity) {
 					if (Collision::AABB(this->entity, e, write_collision)) {
 						if (typeid(decltype(func(this->entity, e))).name() == typeid(void).name())
@@ -113,6 +147,6 @@ public:
 				}
 			}
 		}
-		return *std::move(_mp);
+		return *_mp;
 	}
-};
\ No newline at end of file
+};
@@ -24,8 +24,8 @@ bool Collision::AABB(const SDL_Rect& col1, const SDL_Rect& col2) {
 bool Collision::AABB(const Entity* e1, const Entity* e2, bool write_collision) {
     if (AABB(e1->getComponent<ColliderComponent>().collider, e2->getComponent<ColliderComponent>().collider)) {
         if (write_collision)
-            std::cout << "The " + e1->getComponent<ColliderComponent>().tag + " hit: " +
-            e2->getComponent<ColliderComponent>().tag << std::endl;
+            std::cout << "The " << e1->getComponent<ColliderComponent>().getTagName() << " hit: "
+            << e2->getComponent<ColliderComponent>().getTagName() << '\n';
         return true;
     }
     return false;
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "ECS.h"
+#include "World.h"
+#include "Assets.h"
+#include "RenderState.h"
+#include "Telemetry.h"
 #include "TransformComponent.h"
 #include "SpriteComponent.h"
 #include "KeyboardController.h"
 #include "ColliderComponent.h"
-#include "PhysicsComponent.h"
\ No newline at end of file
+#include "PhysicsComponent.h"
+#include "TileMapComponent.h"
+#include "HierarchyComponent.h"
+#include "ParticleEmitterComponent.h"
+#include "WorldStreamer.h"
@@ -0,0 +1,122 @@
+#include "Components.h"
+#include "ContactSolver.h"
+
+void ContactSolver::removeContact(std::size_t i) {
+    contactIndex.erase({ contacts[i].a, contacts[i].b });
+    if (i + 1 != contacts.size()) {
+        contacts[i] = contacts.back();
+        contactIndex[{ contacts[i].a, contacts[i].b }] = i;
+    }
+    contacts.pop_back();
+}
+
+void ContactSolver::report(PhysicsComponent* a, PhysicsComponent* b, const Manifold& m) {
+    Vector2D normal = m.normal;
+    if (b < a) {
+        std::swap(a, b);
+        normal = normal * -1.0f;
+    }
+
+    std::lock_guard<std::mutex> lock(reportMutex);
+    auto it = contactIndex.find({ a, b });
+    if (it == contactIndex.end()) {
+        it = contactIndex.emplace(std::make_pair(a, b), contacts.size()).first;
+        contacts.emplace_back();
+        contacts.back().a = a;
+        contacts.back().b = b;
+    }
+
+    Contact& c = contacts[it->second];
+    c.normal = normal;
+    c.penetration = m.penetration;
+    c.frame = frame;
+}
+
+void ContactSolver::removeBody(const PhysicsComponent* body) {
+    for (std::size_t i = contacts.size(); i-- > 0;)
+        if (contacts[i].a == body || contacts[i].b == body)
+            removeContact(i);
+}
+
+void ContactSolver::applyImpulse(Contact& c, float impulse) {
+    Vector2D p = c.normal * impulse;
+    c.a->getTransform().velocity -= p * c.a->getInvMass();
+    c.b->getTransform().velocity += p * c.b->getInvMass();
+}
+
+void ContactSolver::prepare(Contact& c) {
+    float k = c.a->getInvMass() + c.b->getInvMass();
+    c.normalMass = k > 0.0f ? 1.0f / k : 0.0f;
+
+    Vector2D rv = c.b->getTransform().velocity - c.a->getTransform().velocity;
+    float velAlongNormal = Vector2D::DotProduct(rv, c.normal);
+    float e = std::min(c.a->getRestitution(), c.b->getRestitution());
+
+    // Bounce only from real impacts, so resting bodies don't jitter. Penetration is removed from the positions
+    // after the impulses, so the correction never becomes velocity that the bodies keep.
+    c.velocityBias = velAlongNormal < -restitutionThreshold ? -e * velAlongNormal : 0.0f;
+    c.startSeparation = separation(c);
+}
+
+float ContactSolver::separation(const Contact& c) {
+    return Vector2D::DotProduct(c.b->getTransform().position - c.a->getTransform().position, c.normal);
+}
+
+void ContactSolver::correctPositions(Contact& c) {
+    float k = c.a->getInvMass() + c.b->getInvMass();
+    if (k == 0.0f)
+        return;
+
+    // The penetration is estimated from how far the bodies have been moved apart since the narrow phase, also by other contacts.
+    float moved = separation(c) - c.startSeparation;
+    float depth = correctionPercent * std::max(c.penetration - moved - slop, 0.0f);
+    depth = std::min(depth, maxCorrection - moved);
+    if (depth <= 0.0f)
+        return;
+
+    Vector2D correction = c.normal * (depth / k);
+    c.a->getTransform().position -= correction * c.a->getInvMass();
+    c.b->getTransform().position += correction * c.b->getInvMass();
+}
+
+void ContactSolver::solve() {
+    // Pairs that were not reported this frame have separated.
+    for (std::size_t i = contacts.size(); i-- > 0;)
+        if (contacts[i].frame != frame)
+            removeContact(i);
+
+    for (auto& c : contacts) {
+        prepare(c);
+        if (warmStarting)
+            applyImpulse(c, c.normalImpulse);
+        else
+            c.normalImpulse = 0.0f;
+    }
+
+    for (int it = 0; it < iterations; ++it) {
+        for (auto& c : contacts) {
+            if (c.normalMass == 0.0f)
+                continue;
+
+            Vector2D rv = c.b->getTransform().velocity - c.a->getTransform().velocity;
+            float velAlongNormal = Vector2D::DotProduct(rv, c.normal);
+            float lambda = c.normalMass * (c.velocityBias - velAlongNormal);
+
+            // Clamp the accumulated impulse, not the increment, so earlier iterations can be partly undone.
+            float accumulated = std::max(c.normalImpulse + lambda, 0.0f);
+            lambda = accumulated - c.normalImpulse;
+            c.normalImpulse = accumulated;
+            applyImpulse(c, lambda);
+        }
+    }
+
+    for (int it = 0; it < iterations; ++it)
+        for (auto& c : contacts)
+            correctPositions(c);
+
+    for (std::size_t i = contacts.size(); i-- > 0;)
+        if (!contacts[i].a->entity->isActive() || !contacts[i].b->entity->isActive())
+            removeContact(i);
+
+    ++frame;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../Vector2D.h"
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+class Entity;
+class PhysicsComponent;
+class Manifold;
+
+/// <summary>
+/// Contact between two bodies, kept between frames for as long as the bodies keep touching.
+/// </summary>
+struct Contact {
+	PhysicsComponent* a;
+	PhysicsComponent* b;
+
+	Vector2D normal;
+	float penetration;
+
+	float normalImpulse = 0.0f;
+	float normalMass = 0.0f;
+	float velocityBias = 0.0f;
+	float startSeparation = 0.0f;
+
+	std::uint64_t frame = 0;
+};
+
+/// <summary>
+/// Sequential impulse solver with a persistent contact cache. Contacts are keyed by body pair, so the impulse accumulated
+/// in the previous frame is applied at the start of the next one (warm starting) and stacks converge in a few iterations.
+/// </summary>
+class ContactSolver {
+private:
+	struct PairHash {
+		std::size_t operator()(const std::pair<const void*, const void*>& p) const {
+			return std::hash<const void*>()(p.first) * 31 + std::hash<const void*>()(p.second);
+		}
+	};
+
+	std::vector<Contact> contacts;
+	std::unordered_map<std::pair<const void*, const void*>, std::size_t, PairHash> contactIndex;
+	std::mutex reportMutex;
+	std::uint64_t frame = 1;
+
+	int iterations = 8;
+	bool warmStarting = true;
+	float correctionPercent = 0.2f;
+	float slop = 0.01f;
+	// The largest distance in pixels by which one contact separates its bodies per step.
+	float maxCorrection = 4.0f;
+	// Bodies approaching each other slower than this along the normal don't bounce. Same units as TransformComponent::velocity.
+	float restitutionThreshold = 1.0f;
+
+	void removeContact(std::size_t i);
+	void prepare(Contact& c);
+	void applyImpulse(Contact& c, float impulse);
+	void correctPositions(Contact& c);
+	static float separation(const Contact& c);
+public:
+	/// <summary>
+	/// Records the contact found by the narrow phase this frame. Can be called from several threads during the update.
+	/// </summary>
+	/// <param name="a - the first body"></param>
+	/// <param name="b - the second body"></param>
+	/// <param name="m - the manifold with the normal pointing from a to b"></param>
+	void report(PhysicsComponent* a, PhysicsComponent* b, const Manifold& m);
+
+	/// <summary>
+	/// Resolves all contacts reported this frame and forgets the pairs that are no longer touching.
+	/// </summary>
+	void solve();
+
+	/// <summary>
+	/// Forgets every contact of the body, for example when its PhysicsComponent is removed.
+	/// </summary>
+	/// <param name="body - the body"></param>
+	void removeBody(const PhysicsComponent* body);
+
+	/// <summary>
+	/// Sets the number of velocity iterations per frame. More iterations give stiffer stacks at a higher cost.
+	/// </summary>
+	/// <param name="count - number of iterations"></param>
+	void setIterations(int count) { iterations = count; }
+
+	/// <summary>
+	/// Turns the reuse of the previous frame's impulses on or off.
+	/// </summary>
+	/// <param name="enabled - true to warm start"></param>
+	void setWarmStarting(bool enabled) { warmStarting = enabled; }
+
+	/// <summary>
+	/// Sets how much of the penetration is removed per frame and how much is allowed to stay. The correction moves the bodies
+	/// directly after the impulses have been solved, so it doesn't depend on TransformComponent::speed and leaves no velocity behind.
+	/// </summary>
+	/// <param name="percent - the part of the remaining penetration that is corrected by each iteration, from 0 to 1"></param>
+	/// <param name="allowedPenetration - the penetration that is not corrected, in pixels"></param>
+	/// <param name="maxPerStep - the largest correction of one contact per frame, in pixels"></param>
+	void setCorrection(float percent, float allowedPenetration, float maxPerStep = 4.0f) {
+		correctionPercent = percent;
+		slop = allowedPenetration;
+		maxCorrection = maxPerStep;
+	}
+
+	/// <summary>
+	/// Sets the approach speed below which a contact is resolved without a bounce, so resting and slowly touching bodies don't jitter.
+	/// </summary>
+	/// <param name="speed - the relative velocity along the contact normal, in the units of TransformComponent::velocity (a body moves by velocity * speed pixels per update); 0 makes every contact bounce"></param>
+	void setRestitutionThreshold(float speed) { restitutionThreshold = speed; }
+
+	std::size_t size() const { return contacts.size(); }
+};
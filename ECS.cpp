@@ -1,6 +1,213 @@
 #include "ECS.h"
+#include <cassert>
+
+namespace {
+	// The update budget is checked once per this many component updates on each thread.
+	constexpr std::uint32_t budgetCheckInterval = 32;
+	thread_local std::uint32_t updatesSinceBudgetCheck = 0;
+}
+
+void Entity::update() {
+	const std::uint64_t tick = manager.tick;
+	float distance = -1.0f;
+
+	for (auto& c : components) {
+		if (!c)
+			continue;
+
+		const UpdatePolicy& policy = c->updatePolicy;
+		if (policy.period > 1 && c->deferredSince == 0 && (tick + phase) % policy.period != 0)
+			continue;
+
+		if (policy.range > 0.0f && manager.focusDistance) {
+			if (distance < 0.0f)
+				distance = manager.focusDistance(*this);
+			if (distance > policy.range * policy.range)
+				continue;
+		}
+
+		if (policy.priority == UpdatePriority::Low) {
+			// Once the budget is used up every low priority update waits. Before that, while components deferred by an
+			// over-budget tick are still waiting, the newer ones wait for them, so the backlog is not starved.
+			// Updates that became due this tick and wait only for that reason are not noted as backlog, so once the old
+			// backlog has run the next tick updates everything again.
+			std::uint64_t since = c->deferredSince != 0 ? c->deferredSince : tick;
+			bool exhausted = manager.overBudget.load(std::memory_order_relaxed);
+			if (exhausted || (manager.oldestDeferred != 0 && since > manager.oldestDeferred)) {
+				c->deferredSince = since;
+				if (exhausted || since != tick)
+					manager.noteDeferred(since);
+				continue;
+			}
+		}
+
+		c->elapsedTicks = static_cast<std::uint32_t>(tick - c->lastUpdateTick);
+		c->lastUpdateTick = tick;
+		c->deferredSince = 0;
+		c->update();
+
+		if (manager.updateBudget.count() > 0 && ++updatesSinceBudgetCheck >= budgetCheckInterval) {
+			updatesSinceBudgetCheck = 0;
+			if (std::chrono::steady_clock::now() - manager.updateStart > manager.updateBudget)
+				manager.overBudget.store(true, std::memory_order_relaxed);
+		}
+	}
+}
 
 void Entity::addGroup(Group group) {
+	if (manager.isUpdating())
+		manager.getCommandBuffer().addGroup(this, group);
+	else
+		installGroup(group);
+}
+
+void Entity::installGroup(Group group) {
+	if (groupBitSet[group])
+		return;
+
+	++manager.churn.regrouped;
 	groupBitSet[group] = true;
 	manager.AddToGroup(this, group);
 }
+
+void Entity::setTag(TagID mTag) {
+	if (manager.isUpdating())
+		manager.getCommandBuffer().setTag(this, mTag);
+	else
+		installTag(mTag);
+}
+
+void Entity::installTag(TagID mTag) {
+	if (tag == mTag)
+		return;
+
+	auto& index = manager.taggedEntities;
+	if (tag != noTag) {
+		auto& list = index[tag];
+		Entity* last = list.back();
+		list[tagSlot] = last;
+		last->tagSlot = tagSlot;
+		list.pop_back();
+	}
+
+	tag = mTag;
+	if (tag != noTag) {
+		if (index.size() <= tag)
+			index.resize(tag + 1);
+		tagSlot = index[tag].size();
+		index[tag].push_back(this);
+	}
+}
+
+std::size_t Entity::footprint() const {
+	std::size_t bytes = sizeof(Entity) + components.capacity() * sizeof(ComponentPtr);
+	auto& types = componentTypes();
+	for (ComponentID id = 0; id < maxComponents; ++id)
+		if (componentBitSet[id])
+			bytes += types[id].size;
+	return bytes;
+}
+
+std::pmr::memory_resource* Entity::memoryResource() {
+	return manager.memory.getPools();
+}
+
+void Entity::attachComponent(ComponentID id, ComponentPtr component) {
+	if (manager.isUpdating())
+		manager.getCommandBuffer().addComponent(this, id, std::move(component));
+	else
+		installComponent(id, std::move(component));
+}
+
+void Entity::installComponent(ComponentID id, ComponentPtr component) {
+	Component* c = component.get();
+
+	// The components that required the old component are unbound before it goes away and bound to the new one once it is initialized.
+	std::array<Component*, maxComponents> bound;
+	std::size_t boundCount = 0;
+
+	if (componentBitSet[id]) {
+		for (auto& other : components)
+			if (other && other.get() != componentArray[id] && other->requiredComponents[id])
+				bound[boundCount++] = other.get();
+
+		if (dependents[id] > boundCount) {
+			std::cout << "[ECS] ERROR: a component required outside of init can't be replaced!" << std::endl;
+			assert(false);
+			return;
+		}
+
+		for (std::size_t i = 0; i < boundCount; ++i)
+			bound[i]->unbind();
+
+		ComponentPtr old = std::move(components[componentSlots[id]]);
+		old->onRemove();
+		old.reset();
+		components[componentSlots[id]] = std::move(component);
+		++manager.churn.componentsRemoved;
+	} else {
+		componentSlots[id] = components.size();
+		components.emplace_back(std::move(component));
+	}
+
+	componentArray[id] = c;
+	componentBitSet[id] = true;
+	c->lastUpdateTick = manager.tick;
+	++manager.churn.componentsAdded;
+
+	Component* outer = initializing;
+	initializing = c;
+	c->init();
+	c->onAdd();
+
+	for (std::size_t i = 0; i < boundCount; ++i) {
+		initializing = bound[i];
+		bound[i]->rebind();
+	}
+	initializing = outer;
+}
+
+void Entity::detachComponent(ComponentID id) {
+	if (manager.isUpdating())
+		manager.getCommandBuffer().removeComponent(this, id);
+	else
+		uninstallComponent(id);
+}
+
+void Entity::uninstallComponent(ComponentID id) {
+	if (!componentBitSet[id])
+		return;
+
+	if (dependents[id] > 0) {
+		std::cout << "[ECS] ERROR: a component required by other components can't be removed!" << std::endl;
+		assert(false);
+		return;
+	}
+
+	ComponentPtr old = std::move(components[componentSlots[id]]);
+	old->onRemove();
+	old.reset();
+
+	componentArray[id] = nullptr;
+	componentBitSet[id] = false;
+	++manager.churn.componentsRemoved;
+
+	if (removedComponents++ == 0)
+		manager.fragmentedEntities.push_back(this);
+}
+
+void Entity::compactComponents() {
+	components.erase(std::remove(std::begin(components), std::end(components), nullptr), std::end(components));
+	removedComponents = 0;
+
+	for (ComponentID id = 0; id < maxComponents; ++id) {
+		if (!componentBitSet[id])
+			continue;
+		for (std::size_t i = 0; i < components.size(); ++i) {
+			if (components[i].get() == componentArray[id]) {
+				componentSlots[id] = i;
+				break;
+			}
+		}
+	}
+}
@@ -6,63 +6,348 @@
 #include <bitset>
 #include <memory>
 #include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <typeinfo>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+#include <ostream>
 #include <stdarg.h>
+#include "Hierarchy.h"
+#include "Memory.h"
+#include "Tag.h"
 
 class Component;
 class Entity;
 class Manager;
+class CommandBuffer;
+class World;
+struct RenderSnapshot;
+struct ManagerStats;
 
 using ComponentID = std::size_t;
 using Group = std::size_t;
+using EntityID = std::uint64_t;
+
+constexpr std::size_t maxComponents = 32;
+constexpr std::size_t maxGroups = 32;
+
+/// <summary>
+/// Name and size of a registered component type, used by the telemetry.
+/// </summary>
+struct ComponentTypeInfo {
+	std::string name;
+	std::size_t size = 0;
+};
+
+/// <summary>
+/// Turns the name returned by std::type_info::name into the name of the type as written in the source.
+/// </summary>
+/// <param name="name - the mangled name on GCC and Clang, or the decorated name on MSVC"></param>
+/// <returns></returns>
+inline std::string readableTypeName(const char* name) {
+#ifdef __GNUG__
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+	if (status == 0 && demangled) {
+		std::string result(demangled);
+		std::free(demangled);
+		return result;
+	}
+	return name;
+#else
+	for (const char* prefix : { "class ", "struct " })
+		if (std::strncmp(name, prefix, std::strlen(prefix)) == 0)
+			return name + std::strlen(prefix);
+	return name;
+#endif
+}
+
+inline std::array<ComponentTypeInfo, maxComponents>& componentTypes() {
+	static std::array<ComponentTypeInfo, maxComponents> types;
+	return types;
+}
 
 inline ComponentID getNewComponentTypeID() {
-	static ComponentID lastID = 0u;
+	static std::atomic<ComponentID> lastID{ 0u };
 	return lastID++;
 }
 
+template<typename T>
+inline ComponentID registerComponentType() {
+	ComponentID id = getNewComponentTypeID();
+	if (id < maxComponents)
+		componentTypes()[id] = { readableTypeName(typeid(T).name()), sizeof(T) };
+	return id;
+}
+
 template<typename T>
 inline ComponentID getComponentTypeID() noexcept {
-	static ComponentID typeID = getNewComponentTypeID();
+	static ComponentID typeID = registerComponentType<T>();
 	return typeID;
 }
 
-constexpr std::size_t maxComponents = 32;
-constexpr std::size_t maxGroups = 32;
-
 using ComponentBitSet = std::bitset<maxComponents>;
 using GroupBitSet = std::bitset<maxGroups>;
 
 using ComponentArray = std::array<Component*, maxComponents>;
 
+enum class UpdatePriority : std::uint8_t { High, Low };
+
+/// <summary>
+/// Describes how often the manager updates a component.
+/// </summary>
+struct UpdatePolicy {
+	// The component is updated every period-th tick. Entities are spread over the ticks by their IDs.
+	std::uint32_t period = 1;
+	// If not 0, the component is updated only while its entity is within this distance of the world's focus, usually the camera.
+	float range = 0.0f;
+	// Low priority updates are deferred when the manager's update budget is used up, and run later oldest first.
+	UpdatePriority priority = UpdatePriority::High;
+
+	static UpdatePolicy everyTick() { return {}; }
+	static UpdatePolicy every(std::uint32_t ticks, UpdatePriority priority = UpdatePriority::High) { return { ticks, 0.0f, priority }; }
+	static UpdatePolicy within(float distance, std::uint32_t ticks = 1, UpdatePriority priority = UpdatePriority::High) { return { ticks, distance, priority }; }
+};
+
 class Component {
+	friend class Entity;
+private:
+	std::uint64_t lastUpdateTick = 0;
+	std::uint64_t deferredSince = 0;
+	ComponentBitSet requiredComponents;
 public:
 	Entity* entity;
 
+	/// <summary>
+	/// How often the component is updated. Usually set in the constructor.
+	/// </summary>
+	UpdatePolicy updatePolicy;
+
+	/// <summary>
+	/// The number of ticks since the previous update, for components that are not updated every tick.
+	/// </summary>
+	std::uint32_t elapsedTicks = 1;
+
 	virtual void init() { }
 	virtual void update() { }
 	virtual void draw() { }
 
+	/// <summary>
+	/// Adds what the component would draw to the snapshot for the render thread.
+	/// </summary>
+	/// <param name="snapshot - the snapshot being filled"></param>
+	/// <param name="layer - the group the entity is drawn in"></param>
+	virtual void publish(RenderSnapshot& /*snapshot*/, Group /*layer*/) { }
+
+	/// <summary>
+	/// Called after init when the component has become part of the entity.
+	/// </summary>
+	virtual void onAdd() { }
+
+	/// <summary>
+	/// Called before the component is removed, replaced or destroyed together with its entity.
+	/// </summary>
+	virtual void onRemove() { }
+
+	/// <summary>
+	/// Called before a component this one required in init is replaced by a new component of the same type.
+	/// By default the component lets go of it like when it is removed, and rebind initializes it again.
+	/// </summary>
+	virtual void unbind() { onRemove(); }
+
+	/// <summary>
+	/// Called after a component this one required in init has been replaced and the new one initialized, to take pointers to the new one.
+	/// </summary>
+	virtual void rebind() { init(); }
+
+	/// <summary>
+	/// Returns true if the last update of the component was deferred because the update budget was used up.
+	/// </summary>
+	/// <returns></returns>
+	bool isOverdue() const { return deferredSince != 0; }
+
 	virtual ~Component() { }
 };
 
+/// <summary>
+/// Returns the memory of a component to the pool it was taken from.
+/// </summary>
+struct ComponentDeleter {
+	void (*release)(Component*) = nullptr;
+
+	void operator()(Component* c) const {
+		release(c);
+	}
+};
+
+using ComponentPtr = std::unique_ptr<Component, ComponentDeleter>;
+
+/// <summary>
+/// Per-thread free list of memory blocks for components of type T. Removed components give their block back, so adding and removing components of the same type does not allocate after warm-up.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T>
+class ComponentPool {
+private:
+	struct FreeList {
+		std::vector<void*> blocks;
+
+		~FreeList() {
+			for (auto b : blocks)
+				::operator delete(b, std::align_val_t(alignof(T)));
+			closed() = true;
+		}
+	};
+
+	static FreeList& freeList() {
+		thread_local FreeList list;
+		return list;
+	}
+
+	// Components of a static Manager can outlive the thread's free list at exit.
+	static bool& closed() {
+		thread_local bool isClosed = false;
+		return isClosed;
+	}
+
+	static void release(Component* c) {
+		T* t = static_cast<T*>(c);
+		t->~T();
+		if (closed())
+			::operator delete(t, std::align_val_t(alignof(T)));
+		else
+			freeList().blocks.push_back(t);
+	}
+public:
+	template<typename... TArgs>
+	static ComponentPtr create(TArgs&&... mArgs) {
+		auto& list = freeList();
+		void* block;
+		if (list.blocks.empty()) {
+			block = ::operator new(sizeof(T), std::align_val_t(alignof(T)));
+		} else {
+			block = list.blocks.back();
+			list.blocks.pop_back();
+		}
+
+		T* c;
+		try {
+			c = new (block) T(std::forward<TArgs>(mArgs)...);
+		} catch (...) {
+			list.blocks.push_back(block);
+			throw;
+		}
+		return ComponentPtr(c, ComponentDeleter{ &ComponentPool<T>::release });
+	}
+
+	/// <summary>
+	/// Allocates blocks in advance, for example before a level starts.
+	/// </summary>
+	/// <param name="count - the number of blocks the pool should hold"></param>
+	static void reserve(std::size_t count) {
+		auto& list = freeList();
+		while (list.blocks.size() < count)
+			list.blocks.push_back(::operator new(sizeof(T), std::align_val_t(alignof(T))));
+	}
+};
+
 class Entity {
+	friend class Manager;
 private:
 	Manager& manager;
+	const EntityID id;
+	const std::uint32_t phase;
 	bool active = true;
-	std::vector<std::unique_ptr<Component>> components;
+	std::pmr::vector<ComponentPtr> components{ memoryResource() };
+	std::size_t removedComponents = 0;
 
-	ComponentArray componentArray;
+	ComponentArray componentArray{};
+	std::array<std::size_t, maxComponents> componentSlots{};
+	std::array<std::uint16_t, maxComponents> dependents{};
 	ComponentBitSet componentBitSet;
 	GroupBitSet groupBitSet;
+	TagID tag = noTag;
+	std::size_t tagSlot = 0;
+	Component* initializing = nullptr;
+
+	/// <summary>
+	/// Attaches the component to the entity, or records it in the command buffer if the manager is updating.
+	/// </summary>
+	void attachComponent(ComponentID id, ComponentPtr component);
+
+	/// <summary>
+	/// Immediately puts the component into the entity and initializes it. A component of the same type is replaced in its slot,
+	/// and the components that required it are bound to the new one (see require).
+	/// </summary>
+	void installComponent(ComponentID id, ComponentPtr component);
+
+	/// <summary>
+	/// Detaches the component, or records the removal in the command buffer if the manager is updating.
+	/// </summary>
+	void detachComponent(ComponentID id);
+
+	/// <summary>
+	/// Immediately removes the component. Its slot is left empty until the next refresh.
+	/// </summary>
+	void uninstallComponent(ComponentID id);
+
+	/// <summary>
+	/// Closes the slots left by removed components.
+	/// </summary>
+	void compactComponents();
+
+	/// <summary>
+	/// Immediately adds the entity to the group.
+	/// </summary>
+	void installGroup(Group mGroup);
+
+	/// <summary>
+	/// Immediately moves the entity to the tag's list in the manager.
+	/// </summary>
+	void installTag(TagID mTag);
+
+	/// <summary>
+	/// Returns the bytes taken by the entity and its components, without memory the components allocate themselves.
+	/// </summary>
+	std::size_t footprint() const;
+
+	/// <summary>
+	/// Returns the size-class pools of the manager. Containers of components added to the entity are allocated from them.
+	/// </summary>
+	std::pmr::memory_resource* memoryResource();
 public:
-	Entity(Manager& mManager) : manager(mManager) {	}
+	Entity(Manager& mManager, EntityID mID)
+		: manager(mManager), id(mID), phase(static_cast<std::uint32_t>((mID * 0x9E3779B97F4A7C15ull) >> 32)) {	}
 
-	void update() {
-		for (auto& c : components) c->update();
+	~Entity() {
+		for (auto& c : components)
+			if (c) c->onRemove();
 	}
 
+	/// <summary>
+	/// Updates the components that are due this tick according to their update policies.
+	/// </summary>
+	void update();
+
 	void draw() {
-		for (auto& c : components) c->draw();
+		for (auto& c : components)
+			if (c) c->draw();
+	}
+
+	void publish(RenderSnapshot& snapshot, Group layer) {
+		for (auto& c : components)
+			if (c) c->publish(snapshot, layer);
 	}
 
 	/// <summary>
@@ -71,11 +356,35 @@ public:
 	/// <returns></returns>
 	bool isActive() { return active; }
 
+	/// <summary>
+	/// Returns the component types of the entity.
+	/// </summary>
+	/// <returns></returns>
+	const ComponentBitSet& getComponentTypes() const { return componentBitSet; }
+
+	/// <summary>
+	/// Returns the ID of the entity, unique within its manager.
+	/// </summary>
+	/// <returns></returns>
+	EntityID getID() const { return id; }
+
+	/// <summary>
+	/// Returns the manager that owns the entity.
+	/// </summary>
+	/// <returns></returns>
+	Manager& getManager() { return manager; }
+
 	/// <summary>
 	/// Destroys the essence.
 	/// </summary>
 	void destroy() { active = false; }
 
+	/// <summary>
+	/// Returns the groups the entity belongs to.
+	/// </summary>
+	/// <returns></returns>
+	const GroupBitSet& getGroups() const { return groupBitSet; }
+
 	/// <summary>
 	/// Returns true if the entity belongs to the specified group, and false if not.
 	/// </summary>
@@ -86,11 +395,36 @@ public:
 	}
 
 	/// <summary>
-	/// Adds an entity to the specified group.
+	/// Adds an entity to the specified group. While the manager is updating, the entity joins the group at the next refresh.
 	/// </summary>
 	/// <param name="mGroup - entity group number"></param>
 	void addGroup(Group mGroup);
 
+	/// <summary>
+	/// Returns the tag of the entity, or noTag.
+	/// </summary>
+	/// <returns></returns>
+	TagID getTag() const { return tag; }
+
+	/// <summary>
+	/// Returns true if the entity has the specified tag, and false if not.
+	/// </summary>
+	/// <param name="mTag - the tag returned by Tags::intern"></param>
+	/// <returns></returns>
+	bool hasTag(TagID mTag) const { return tag == mTag; }
+
+	/// <summary>
+	/// Sets the tag of the entity, replacing the previous one. While the manager is updating, the tag changes at the next refresh.
+	/// </summary>
+	/// <param name="mTag - the tag returned by Tags::intern, or noTag to remove the tag"></param>
+	void setTag(TagID mTag);
+
+	/// <summary>
+	/// Sets the tag of the entity by name.
+	/// </summary>
+	/// <param name="name - the tag name"></param>
+	void setTag(std::string_view name) { setTag(Tags::intern(name)); }
+
 	/// <summary>
 	/// Deletes an entity from the specified group.
 	/// </summary>
@@ -111,7 +445,9 @@ public:
 
 
 	/// <summary>
-	/// Adds the component specified in the template to the entity.
+	/// Adds the component specified in the template to the entity. If the entity already has a component of this type, it is replaced.
+	/// While the manager is updating, the component is attached and initialized at the next refresh. Until then the returned reference
+	/// may only be used to set up the component: it is not yet returned by getComponent, and its init hasn't run.
 	/// </summary>
 	/// <typeparam name="T"></typeparam>
 	/// <typeparam name="...TArgs"></typeparam>
@@ -119,33 +455,66 @@ public:
 	/// <returns></returns>
 	template<typename T, typename... TArgs>
 	T& addComponent(TArgs&&... mArgs) {
-		T* c(new T(std::forward<TArgs>(mArgs)...));
+		Memory::Scope scope(memoryResource());
+		ComponentPtr uPtr = ComponentPool<T>::create(std::forward<TArgs>(mArgs)...);
+		T* c = static_cast<T*>(uPtr.get());
 		c->entity = this;
-		std::unique_ptr<Component> uPtr{ c };
-		components.emplace_back(std::move(uPtr));
-
-		componentArray[getComponentTypeID<T>()] = c;
-		componentBitSet[getComponentTypeID<T>()] = true;
-
-		c->init();
+		attachComponent(getComponentTypeID<T>(), std::move(uPtr));
 		return *c;
 	}
 
 	/// <summary>
-	/// Adds the component specified in the template to the entity.
+	/// Adds the component specified in the template to the entity. If the entity already has a component of this type, it is replaced.
+	/// While the manager is updating, the returned component isn't attached or initialized until the next refresh.
 	/// </summary>
 	template<typename T>
 	T& addComponent() {
-		T* c(new T());
+		Memory::Scope scope(memoryResource());
+		ComponentPtr uPtr = ComponentPool<T>::create();
+		T* c = static_cast<T*>(uPtr.get());
 		c->entity = this;
-		std::unique_ptr<Component> uPtr{ c };
-		components.emplace_back(std::move(uPtr));
+		attachComponent(getComponentTypeID<T>(), std::move(uPtr));
+		return *c;
+	}
 
-		componentArray[getComponentTypeID<T>()] = c;
-		componentBitSet[getComponentTypeID<T>()] = true;
+	/// <summary>
+	/// Removes the component specified in the template from the entity and returns its memory to the pool.
+	/// While the manager is updating, the component is removed at the next refresh. Components required by other components are not removed.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	template<typename T>
+	void removeComponent() {
+		detachComponent(getComponentTypeID<T>());
+	}
 
-		c->init();
-		return *c;
+	/// <summary>
+	/// Returns the component specified in the template, adding it if the entity doesn't have it, and marks it as used by the caller.
+	/// Components keep pointers to the components they require, so a required component can't be removed until every component
+	/// that required it has called release, normally from its onRemove. When it is replaced, the components that required it
+	/// in their init are unbound from it and bound to the new one (see Component::unbind).
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <returns></returns>
+	template<typename T>
+	T& require() {
+		Component* dependent = initializing;
+		T& c = hasComponent<T>() ? getComponent<T>() : addComponent<T>();
+		ComponentID id = getComponentTypeID<T>();
+		++dependents[id];
+		if (dependent)
+			dependent->requiredComponents[id] = true;
+		return c;
+	}
+
+	/// <summary>
+	/// Marks the component specified in the template as no longer used by the caller.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	template<typename T>
+	void release() {
+		auto& count = dependents[getComponentTypeID<T>()];
+		if (count > 0)
+			--count;
 	}
 
 	/// <summary>
@@ -160,14 +529,328 @@ public:
 	}
 };
 
+/// <summary>
+/// Records structural changes made while the manager is updating. The changes are applied at Manager::refresh.
+/// </summary>
+class CommandBuffer {
+	friend class Manager;
+private:
+	struct PendingComponent {
+		Entity* entity;
+		ComponentID id;
+		ComponentPtr component;
+	};
+
+	std::vector<std::unique_ptr<Entity>> createdEntities;
+	std::vector<PendingComponent> addedComponents;
+	std::vector<std::pair<Entity*, Group>> addedGroups;
+	std::vector<std::pair<Entity*, TagID>> changedTags;
+	std::vector<std::function<void()>> calls;
+public:
+	void addEntity(std::unique_ptr<Entity> mEntity) {
+		createdEntities.emplace_back(std::move(mEntity));
+	}
+
+	void addComponent(Entity* mEntity, ComponentID id, ComponentPtr component) {
+		addedComponents.push_back({ mEntity, id, std::move(component) });
+	}
+
+	void removeComponent(Entity* mEntity, ComponentID id) {
+		addedComponents.push_back({ mEntity, id, nullptr });
+	}
+
+	void addGroup(Entity* mEntity, Group mGroup) {
+		addedGroups.emplace_back(mEntity, mGroup);
+	}
+
+	void setTag(Entity* mEntity, TagID mTag) {
+		changedTags.emplace_back(mEntity, mTag);
+	}
+
+	/// <summary>
+	/// Records a function that is called after the other changes have been applied, for operations that need components added this frame.
+	/// </summary>
+	/// <param name="call - the function; the entities it uses must be looked up again, as components may have been replaced"></param>
+	void defer(std::function<void()> call) {
+		calls.emplace_back(std::move(call));
+	}
+
+	bool empty() const {
+		return createdEntities.empty() && addedComponents.empty() && addedGroups.empty() && changedTags.empty() && calls.empty();
+	}
+};
+
+/// <summary>
+/// Structural changes of one frame.
+/// </summary>
+struct ChurnStats {
+	std::size_t created = 0;
+	std::size_t destroyed = 0;
+	// Entities joining or leaving a group.
+	std::size_t regrouped = 0;
+	std::size_t componentsAdded = 0;
+	std::size_t componentsRemoved = 0;
+};
+
+constexpr std::size_t maxWorkers = 64;
+
+/// <summary>
+/// Gives every running thread a small worker number. The numbers of finished threads are reused, so they stay below the number of threads alive at once.
+/// </summary>
+class WorkerIDs {
+private:
+	std::mutex mutex;
+	std::vector<std::size_t> freeIDs;
+	std::size_t nextID = 0;
+
+	// Never destroyed, so threads that finish after the static destructors can still return their numbers.
+	static WorkerIDs& registry() {
+		static WorkerIDs* ids = new WorkerIDs();
+		return *ids;
+	}
+
+	std::size_t acquire() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (freeIDs.empty())
+			return nextID++;
+		std::size_t id = freeIDs.back();
+		freeIDs.pop_back();
+		return id;
+	}
+
+	void release(std::size_t id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		freeIDs.push_back(id);
+	}
+public:
+	/// <summary>
+	/// Returns the worker number of the calling thread.
+	/// </summary>
+	/// <returns></returns>
+	static std::size_t current() {
+		struct Slot {
+			std::size_t id = registry().acquire();
+			~Slot() { registry().release(id); }
+		};
+		thread_local Slot slot;
+		return slot.id;
+	}
+};
+
 class Manager {
+	friend class Entity;
 private:
+	// Declared first so that everything allocated from it is destroyed before it.
+	Memory memory;
+
 	std::vector<Group> layerOrder;
+	Hierarchy hierarchy;
 	std::vector<std::unique_ptr<Entity>> entities;
 	std::array<std::vector<Entity*>, maxGroups> groupedEntities;
+	std::vector<Entity*> fragmentedEntities;
+	std::vector<std::vector<Entity*>> taggedEntities;
+
+	ChurnStats churn;
+	ChurnStats lastChurn;
+	std::ostream* statsOutput = nullptr;
+	std::uint64_t statsInterval = 0;
+
+	std::atomic<EntityID> nextEntityID{ 0 };
+	std::uint64_t tick = 0;
+	std::function<float(Entity&)> focusDistance;
+	std::chrono::steady_clock::duration updateBudget{ 0 };
+	std::chrono::steady_clock::time_point updateStart;
+	std::atomic<bool> overBudget{ false };
+	// Low priority components deferred since a later tick than this wait until the older ones have run.
+	std::uint64_t oldestDeferred = 0;
+	std::atomic<std::uint64_t> nextOldestDeferred{ 0 };
+
+	/// <summary>
+	/// Notes a deferred component, so that the oldest deferred ones run first in the next tick.
+	/// </summary>
+	void noteDeferred(std::uint64_t since) {
+		std::uint64_t oldest = nextOldestDeferred.load(std::memory_order_relaxed);
+		while ((oldest == 0 || since < oldest) && !nextOldestDeferred.compare_exchange_weak(oldest, since, std::memory_order_relaxed)) { }
+	}
+
+	World* world = nullptr;
+	bool updating = false;
+	std::mutex buffersMutex;
+	std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+	// The command buffer of each worker, indexed by WorkerIDs::current(). Workers past maxWorkers use overflowBuffers under buffersMutex.
+	std::array<std::atomic<CommandBuffer*>, maxWorkers> workerBuffers{};
+	std::unordered_map<std::size_t, CommandBuffer*> overflowBuffers;
+
+	/// <summary>
+	/// Applies the changes recorded in all command buffers: new entities first, then component additions and removals in the order they were made, then groups and tags,
+	/// and finally the deferred calls.
+	/// </summary>
+	void flushCommands() {
+		for (auto& b : commandBuffers) {
+			churn.created += b->createdEntities.size();
+			for (auto& e : b->createdEntities)
+				entities.emplace_back(std::move(e));
+			b->createdEntities.clear();
+		}
+
+		for (auto& b : commandBuffers) {
+			for (auto& c : b->addedComponents) {
+				if (c.component)
+					c.entity->installComponent(c.id, std::move(c.component));
+				else
+					c.entity->uninstallComponent(c.id);
+			}
+			b->addedComponents.clear();
+		}
+
+		for (auto& b : commandBuffers) {
+			for (auto& g : b->addedGroups)
+				g.first->installGroup(g.second);
+			b->addedGroups.clear();
+		}
+
+		for (auto& b : commandBuffers) {
+			for (auto& t : b->changedTags)
+				t.first->installTag(t.second);
+			b->changedTags.clear();
+		}
+
+		for (auto& b : commandBuffers) {
+			for (auto& call : b->calls)
+				call();
+			b->calls.clear();
+		}
+	}
 public:
 	void update() {
+		beginUpdate();
 		for (auto& e : entities) e->update();
+		endUpdate();
+	}
+
+	/// <summary>
+	/// Starts the update phase of the next tick. Until endUpdate, structural changes are recorded into per-thread command buffers, so entities can be updated from several threads.
+	/// </summary>
+	void beginUpdate() {
+		updating = true;
+		++tick;
+		updateStart = std::chrono::steady_clock::now();
+		overBudget.store(false, std::memory_order_relaxed);
+		oldestDeferred = nextOldestDeferred.exchange(0, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Updates a slice of the entity list. Must be called between beginUpdate and endUpdate.
+	/// </summary>
+	/// <param name="first - index of the first entity"></param>
+	/// <param name="count - number of entities"></param>
+	void update(std::size_t first, std::size_t count) {
+		std::size_t last = std::min(first + count, entities.size());
+		for (std::size_t i = first; i < last; ++i) entities[i]->update();
+	}
+
+	/// <summary>
+	/// Ends the update phase and moves attached entities after their parents. The recorded changes are applied at the next refresh.
+	/// </summary>
+	void endUpdate() {
+		updating = false;
+		hierarchy.propagate();
+	}
+
+	/// <summary>
+	/// Returns the number of update phases started so far.
+	/// </summary>
+	/// <returns></returns>
+	std::uint64_t getTick() const { return tick; }
+
+	/// <summary>
+	/// Sets the function that returns the squared distance of an entity from the focus of the world. It is used for UpdatePolicy::range and called at most once per entity and tick.
+	/// </summary>
+	/// <param name="distanceSquared - the function; without it every entity is in range"></param>
+	void setFocusDistance(std::function<float(Entity&)> distanceSquared) {
+		focusDistance = std::move(distanceSquared);
+	}
+
+	/// <summary>
+	/// Limits the time of the update phase spent before low priority components are deferred. The clock is checked every few components, so the limit can be exceeded slightly.
+	/// </summary>
+	/// <param name="milliseconds - the budget, or 0 for no limit"></param>
+	void setUpdateBudget(float milliseconds) {
+		updateBudget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(milliseconds));
+	}
+
+	/// <summary>
+	/// Returns true if the budget of the current or last update phase has been used up.
+	/// </summary>
+	/// <returns></returns>
+	bool isOverBudget() const { return overBudget.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Returns true if the manager is in the update phase.
+	/// </summary>
+	/// <returns></returns>
+	bool isUpdating() const { return updating; }
+
+	/// <summary>
+	/// Returns the number of entities that have been committed to the manager.
+	/// </summary>
+	/// <returns></returns>
+	std::size_t entityCount() const { return entities.size(); }
+
+	/// <summary>
+	/// Returns the world the manager belongs to. Only managers owned by a World have one, set with setWorld.
+	/// </summary>
+	/// <returns></returns>
+	World& getWorld() {
+		assert(world && "Manager::getWorld called on a manager that is not owned by a World");
+		return *world;
+	}
+
+	/// <summary>
+	/// Returns true if the manager belongs to a world.
+	/// </summary>
+	/// <returns></returns>
+	bool hasWorld() const { return world != nullptr; }
+
+	void setWorld(World* mWorld) { world = mWorld; }
+
+	/// <summary>
+	/// Returns the frame arena, the size-class pools and the allocation counters of the manager.
+	/// </summary>
+	/// <returns></returns>
+	Memory& getMemory() { return memory; }
+
+	/// <summary>
+	/// Returns the parent-child links between entity positions.
+	/// </summary>
+	/// <returns></returns>
+	Hierarchy& getHierarchy() { return hierarchy; }
+
+	/// <summary>
+	/// Returns the command buffer of the calling thread.
+	/// </summary>
+	/// <returns></returns>
+	CommandBuffer& getCommandBuffer() {
+		std::size_t worker = WorkerIDs::current();
+		if (worker < maxWorkers) {
+			CommandBuffer* buffer = workerBuffers[worker].load(std::memory_order_acquire);
+			if (buffer)
+				return *buffer;
+		}
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		if (worker < maxWorkers) {
+			commandBuffers.emplace_back(new CommandBuffer());
+			workerBuffers[worker].store(commandBuffers.back().get(), std::memory_order_release);
+			return *commandBuffers.back();
+		}
+
+		CommandBuffer*& buffer = overflowBuffers[worker];
+		if (!buffer) {
+			commandBuffers.emplace_back(new CommandBuffer());
+			buffer = commandBuffers.back().get();
+		}
+		return *buffer;
 	}
 
 	void draw() {
@@ -182,28 +865,93 @@ public:
 			for (auto& e : getGroup(layer)) e->draw();
 	}
 
+	/// <summary>
+	/// Fills the snapshot for the render thread with the groups in the order specified in the set Layer Order function.
+	/// </summary>
+	/// <param name="snapshot - the snapshot being filled"></param>
+	void publish(RenderSnapshot& snapshot) {
+		for (auto& layer : layerOrder)
+			for (auto& e : getGroup(layer)) e->publish(snapshot, layer);
+	}
+
+	/// <summary>
+	/// Applies the recorded structural changes and removes destroyed entities. This is the only point at which the entity and group lists change during a frame.
+	/// Everything allocated from the frame arena during the frame is released here.
+	/// </summary>
 	void refresh() {
+		flushCommands();
+
+		for (auto e : fragmentedEntities)
+			e->compactComponents();
+		fragmentedEntities.clear();
+
 		for (auto i(0u); i < maxGroups; ++i) {
 			auto& v(groupedEntities[i]);
 			v.erase(std::remove_if(std::begin(v), std::end(v),
-				[i](Entity* entity) {
-					return !entity->isActive() || !entity->hasGroup(i);
+				[this, i](Entity* entity) {
+					if (!entity->isActive())
+						return true;
+					if (entity->hasGroup(i))
+						return false;
+					++churn.regrouped;
+					return true;
 				}), std::end(v));
 		}
 
 		entities.erase(std::remove_if(std::begin(entities), std::end(entities),
-			[](const std::unique_ptr<Entity>& mEntity) {
-				return !mEntity->isActive();
+			[this](const std::unique_ptr<Entity>& mEntity) {
+				if (mEntity->isActive())
+					return false;
+				mEntity->installTag(noTag);
+				++churn.destroyed;
+				churn.componentsRemoved += mEntity->componentBitSet.count();
+				return true;
 			}), std::end(entities));
+
+		memory.endFrame();
+		lastChurn = churn;
+		churn = {};
+
+		if (statsOutput && tick % statsInterval == 0)
+			dumpStats(*statsOutput);
+	}
+
+	/// <summary>
+	/// Fills the statistics with live counts and bytes per component type, group and archetype, the allocation counters and the churn of the last frame.
+	/// It walks all entities, so it is meant to be called at intervals rather than every frame.
+	/// </summary>
+	/// <param name="stats - receives the statistics; its vectors are reused"></param>
+	void collectStats(ManagerStats& stats) const;
+
+	/// <summary>
+	/// Writes the current statistics as one line of JSON.
+	/// </summary>
+	/// <param name="out - the stream"></param>
+	void dumpStats(std::ostream& out) const;
+
+	/// <summary>
+	/// Writes the statistics as JSON at every refresh whose tick is a multiple of the interval.
+	/// </summary>
+	/// <param name="out - the stream, or nullptr to stop"></param>
+	/// <param name="intervalTicks - the number of ticks between two dumps"></param>
+	void setStatsOutput(std::ostream* out, std::uint64_t intervalTicks) {
+		statsOutput = intervalTicks > 0 ? out : nullptr;
+		statsInterval = intervalTicks;
 	}
 
+	/// <summary>
+	/// Returns the structural changes of the last frame, counted from one refresh to the next.
+	/// </summary>
+	/// <returns></returns>
+	const ChurnStats& getChurn() const { return lastChurn; }
+
 	/// <summary>
 	/// Sets the sequence of rendering entity groups.
 	/// </summary>
 	/// <param name="layers_amount - the number of subsequent layer parameters"></param>
 	/// <param name="... - the layers in the sequence in which they will be drawn"></param>
 	void setLayerOrder(int layers_amount, ...) {
-		layerOrder.resize(layers_amount);
+		layerOrder.clear();
 		va_list argGroups;
 		va_start(argGroups, layers_amount);
 		for (size_t i = 0; i < layers_amount; i++) {
@@ -230,10 +978,38 @@ public:
 		return groupedEntities[mGroup];
 	}
 
+	/// <summary>
+	/// Returns the live entities with the specified tag, in no particular order. The list changes only at refresh, or immediately when tags are set outside the update phase.
+	/// </summary>
+	/// <param name="mTag - the tag returned by Tags::intern"></param>
+	/// <returns></returns>
+	const std::vector<Entity*>& getTagged(TagID mTag) const {
+		static const std::vector<Entity*> none;
+		return mTag < taggedEntities.size() ? taggedEntities[mTag] : none;
+	}
+
+	/// <summary>
+	/// Returns the live entities with the specified tag name. Unknown names are not added to the tag table.
+	/// </summary>
+	/// <param name="name - the tag name"></param>
+	/// <returns></returns>
+	const std::vector<Entity*>& getTagged(std::string_view name) const {
+		return getTagged(Tags::find(name));
+	}
+
+	/// <summary>
+	/// Creates a new entity. While the manager is updating, the entity is staged and starts updating after the next refresh.
+	/// </summary>
+	/// <returns></returns>
 	Entity& addEntity() {
-		Entity* e = new Entity(*this);
+		Entity* e = new Entity(*this, nextEntityID++);
 		std::unique_ptr<Entity> uPtr{ e };
-		entities.emplace_back(std::move(uPtr));
+		if (updating) {
+			getCommandBuffer().addEntity(std::move(uPtr));
+		} else {
+			entities.emplace_back(std::move(uPtr));
+			++churn.created;
+		}
 		return *e;
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "../Vector2D.h"
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+class Entity;
+
+using HierarchyNode = std::size_t;
+
+/// <summary>
+/// Parent-child links between entity positions. Nodes are stored in depth-first order, so every parent comes before its children
+/// and world positions are propagated in a single pass over the array. Removed nodes stay in the array until the next propagate,
+/// so destroying a large subtree costs one compaction instead of one pass over the array per node.
+/// </summary>
+class Hierarchy {
+public:
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+	struct Node {
+		HierarchyNode id;
+		HierarchyNode parentID;
+		std::size_t subtreeSize;
+
+		Entity* owner;
+		Vector2D* position;
+		Vector2D local;
+		Vector2D world;
+
+		bool dirty;
+		bool changed;
+		bool removed;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<std::size_t> indices;
+	std::vector<HierarchyNode> freeIDs;
+	std::size_t removedCount = 0;
+
+	std::size_t parentOf(const Node& n) const {
+		return n.parentID == npos ? npos : indices[n.parentID];
+	}
+
+	/// <summary>
+	/// Recomputes the indices of the nodes in a range of the array after it has been reordered.
+	/// </summary>
+	void reindex(std::size_t first, std::size_t last) {
+		for (std::size_t i = first; i < last; ++i)
+			if (!nodes[i].removed)
+				indices[nodes[i].id] = i;
+	}
+
+	/// <summary>
+	/// Drops the removed nodes and recomputes the indices and subtree sizes in one pass each.
+	/// </summary>
+	void compact() {
+		if (removedCount == 0)
+			return;
+
+		nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [](const Node& n) { return n.removed; }), nodes.end());
+		removedCount = 0;
+		reindex(0, nodes.size());
+
+		for (auto& n : nodes)
+			n.subtreeSize = 1;
+		for (std::size_t i = nodes.size(); i-- > 0;) {
+			std::size_t p = parentOf(nodes[i]);
+			if (p != npos)
+				nodes[p].subtreeSize += nodes[i].subtreeSize;
+		}
+	}
+
+	void resizeAncestors(std::size_t index, std::ptrdiff_t delta) {
+		for (std::size_t p = parentOf(nodes[index]); p != npos; p = parentOf(nodes[p]))
+			nodes[p].subtreeSize += delta;
+	}
+
+	bool isInSubtree(std::size_t index, std::size_t root) const {
+		return index >= root && index < root + nodes[root].subtreeSize;
+	}
+public:
+	/// <summary>
+	/// Adds a root node that controls the specified world position.
+	/// </summary>
+	/// <param name="owner - the entity the node belongs to"></param>
+	/// <param name="position - the world position written by the hierarchy, usually TransformComponent::position"></param>
+	/// <returns></returns>
+	HierarchyNode add(Entity* owner, Vector2D* position) {
+		HierarchyNode id;
+		if (freeIDs.empty()) {
+			id = indices.size();
+			indices.push_back(npos);
+		} else {
+			id = freeIDs.back();
+			freeIDs.pop_back();
+		}
+
+		indices[id] = nodes.size();
+		nodes.push_back({ id, npos, 1, owner, position, *position, *position, false, false, false });
+		return id;
+	}
+
+	/// <summary>
+	/// Removes the node. Its children are attached to its parent and keep their world positions.
+	/// The node stays in the array as a placeholder until the next propagate, so nothing after it moves.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	void remove(HierarchyNode id) {
+		std::size_t index = indices[id];
+		Node& n = nodes[index];
+
+		std::size_t parent = parentOf(n);
+		Vector2D parentWorld = parent == npos ? Vector2D() : nodes[parent].world;
+		for (std::size_t c = index + 1; c < index + n.subtreeSize; c += nodes[c].subtreeSize) {
+			nodes[c].parentID = n.parentID;
+			nodes[c].local = nodes[c].world - parentWorld;
+		}
+
+		// The children become siblings that follow the placeholder inside the parent's range.
+		n.subtreeSize = 1;
+		n.removed = true;
+		n.owner = nullptr;
+		n.position = nullptr;
+		++removedCount;
+
+		indices[id] = npos;
+		freeIDs.push_back(id);
+	}
+
+	/// <summary>
+	/// Attaches the node with its whole subtree to a new parent. The world position is kept.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	/// <param name="parentID - the new parent, or npos to make the node a root"></param>
+	/// <returns>false if the parent is the node itself or one of its descendants</returns>
+	bool setParent(HierarchyNode id, HierarchyNode parentID) {
+		std::size_t index = indices[id];
+		if (parentID != npos && isInSubtree(indices[parentID], index))
+			return false;
+
+		std::size_t size = nodes[index].subtreeSize;
+
+		// The subtree goes to the end of the new parent's range. Sizes and that end are taken while the indices are still valid.
+		std::size_t p = parentID == npos ? npos : indices[parentID];
+		std::size_t end = p == npos ? nodes.size() : p + nodes[p].subtreeSize;
+		Vector2D parentWorld = p == npos ? Vector2D() : nodes[p].world;
+		resizeAncestors(index, -static_cast<std::ptrdiff_t>(size));
+		if (p != npos) {
+			nodes[p].subtreeSize += size;
+			resizeAncestors(p, static_cast<std::ptrdiff_t>(size));
+		}
+
+		// Moving the subtree shifts only the nodes between its old and new place.
+		std::size_t first, last, moved;
+		if (end > index) {
+			first = index;
+			last = end;
+			moved = end - size;
+			std::rotate(nodes.begin() + index, nodes.begin() + index + size, nodes.begin() + end);
+		} else {
+			first = end;
+			last = index + size;
+			moved = end;
+			std::rotate(nodes.begin() + end, nodes.begin() + index, nodes.begin() + index + size);
+		}
+		reindex(first, last);
+
+		Node& n = nodes[moved];
+		n.parentID = parentID;
+		n.local = n.world - parentWorld;
+		n.dirty = true;
+		return true;
+	}
+
+	/// <summary>
+	/// Writes the world positions of all nodes whose own or parent position has changed since the previous call.
+	/// A position moved from outside, for example by velocity, is treated as a change of the local offset.
+	/// </summary>
+	void propagate() {
+		compact();
+
+		for (auto& n : nodes) {
+			if (!(*n.position == n.world)) {
+				n.local += *n.position - n.world;
+				n.dirty = true;
+			}
+
+			std::size_t parent = parentOf(n);
+			n.changed = n.dirty || (parent != npos && nodes[parent].changed);
+			n.dirty = false;
+
+			if (n.changed) {
+				n.world = parent == npos ? n.local : nodes[parent].world + n.local;
+				*n.position = n.world;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Sets the position of the node relative to its parent.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	/// <param name="local - the offset from the parent, or the world position for a root"></param>
+	void setLocal(HierarchyNode id, const Vector2D& local) {
+		Node& n = nodes[indices[id]];
+		n.local = local;
+		n.dirty = true;
+	}
+
+	/// <summary>
+	/// Makes the node control another position, for example after the TransformComponent of its entity has been replaced.
+	/// The new position becomes the world position of the node at the next propagate.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	/// <param name="position - the world position written by the hierarchy"></param>
+	void setPosition(HierarchyNode id, Vector2D* position) {
+		nodes[indices[id]].position = position;
+	}
+
+	const Vector2D& getLocal(HierarchyNode id) const {
+		return nodes[indices[id]].local;
+	}
+
+	const Vector2D& getWorld(HierarchyNode id) const {
+		return nodes[indices[id]].world;
+	}
+
+	/// <summary>
+	/// Returns the entity of the parent node, or nullptr for a root.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	/// <returns></returns>
+	Entity* getParent(HierarchyNode id) const {
+		std::size_t parent = parentOf(nodes[indices[id]]);
+		return parent == npos ? nullptr : nodes[parent].owner;
+	}
+
+	/// <summary>
+	/// Appends the entities of the direct children of the node.
+	/// </summary>
+	/// <param name="id - the node"></param>
+	/// <param name="out - the vector to which the children are appended"></param>
+	void getChildren(HierarchyNode id, std::vector<Entity*>& out) const {
+		std::size_t index = indices[id];
+		for (std::size_t c = index + 1; c < index + nodes[index].subtreeSize; c += nodes[c].subtreeSize)
+			if (!nodes[c].removed)
+				out.push_back(nodes[c].owner);
+	}
+
+	std::size_t size() const { return nodes.size() - removedCount; }
+};
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Components.h"
+#include "Hierarchy.h"
+#include <cassert>
+
+class HierarchyComponent : public Component {
+private:
+	TransformComponent* transform;
+	Hierarchy* hierarchy = nullptr;
+	HierarchyNode node = Hierarchy::npos;
+
+	bool attach(Entity* parent) {
+		if (!parent->hasComponent<HierarchyComponent>())
+			parent->addComponent<HierarchyComponent>();
+
+		HierarchyComponent& p = parent->getComponent<HierarchyComponent>();
+		assert(p.hierarchy);
+		if (!p.hierarchy)
+			return false;
+		return hierarchy->setParent(node, p.node);
+	}
+
+	/// <summary>
+	/// Records the change to be made at the next refresh, after the components added this frame have been initialized.
+	/// </summary>
+	template<typename F>
+	void defer(F change) {
+		Entity* child = entity;
+		entity->getManager().getCommandBuffer().defer([child, change]() {
+			if (child->hasComponent<HierarchyComponent>())
+				change(child->getComponent<HierarchyComponent>());
+		});
+	}
+
+public:
+	HierarchyComponent() = default;
+
+	void init() override {
+		transform = &entity->require<TransformComponent>();
+
+		hierarchy = &entity->getManager().getHierarchy();
+		node = hierarchy->add(entity, &transform->position);
+	}
+
+	void onRemove() override {
+		hierarchy->remove(node);
+		entity->release<TransformComponent>();
+	}
+
+	/// <summary>
+	/// Keeps the node and its parent and children while the TransformComponent is replaced.
+	/// </summary>
+	void unbind() override { }
+
+	void rebind() override {
+		transform = &entity->getComponent<TransformComponent>();
+		hierarchy->setPosition(node, &transform->position);
+	}
+
+	/// <summary>
+	/// Attaches the entity to the parent. The entity keeps its world position and then follows the parent.
+	/// While the manager is updating, the entity is attached at the next refresh.
+	/// </summary>
+	/// <param name="parent - the parent entity; it gets a HierarchyComponent if it doesn't have one"></param>
+	/// <returns>false if the parent is the entity itself or one of its children; true if the change has been deferred</returns>
+	bool setParent(Entity* parent) {
+		if (entity->getManager().isUpdating()) {
+			defer([parent](HierarchyComponent& c) { c.attach(parent); });
+			return true;
+		}
+		return attach(parent);
+	}
+
+	/// <summary>
+	/// Attaches the entity to the parent at the specified offset from it.
+	/// </summary>
+	/// <param name="parent - the parent entity"></param>
+	/// <param name="offset - the position relative to the parent"></param>
+	/// <returns></returns>
+	bool setParent(Entity* parent, const Vector2D& offset) {
+		if (entity->getManager().isUpdating()) {
+			defer([parent, offset](HierarchyComponent& c) {
+				if (c.attach(parent))
+					c.hierarchy->setLocal(c.node, offset);
+			});
+			return true;
+		}
+
+		if (!attach(parent))
+			return false;
+		hierarchy->setLocal(node, offset);
+		return true;
+	}
+
+	/// <summary>
+	/// Detaches the entity from its parent. The entity stays where it is. While the manager is updating, the entity is detached at the next refresh.
+	/// </summary>
+	void detach() {
+		if (entity->getManager().isUpdating())
+			defer([](HierarchyComponent& c) { c.hierarchy->setParent(c.node, Hierarchy::npos); });
+		else
+			hierarchy->setParent(node, Hierarchy::npos);
+	}
+
+	/// <summary>
+	/// Returns the parent entity, or nullptr if the entity is not attached.
+	/// </summary>
+	/// <returns></returns>
+	Entity* getParent() const {
+		return hierarchy->getParent(node);
+	}
+
+	/// <summary>
+	/// Appends the direct children of the entity to the vector.
+	/// </summary>
+	/// <param name="out - the vector to which the children are appended"></param>
+	void getChildren(std::vector<Entity*>& out) const {
+		hierarchy->getChildren(node, out);
+	}
+
+	/// <summary>
+	/// Sets the position relative to the parent. The world position is updated at the end of the next update.
+	/// </summary>
+	/// <param name="local - the offset from the parent"></param>
+	void setLocalPosition(const Vector2D& local) {
+		hierarchy->setLocal(node, local);
+	}
+
+	const Vector2D& getLocalPosition() const {
+		return hierarchy->getLocal(node);
+	}
+
+	const Vector2D& getWorldPosition() const {
+		return hierarchy->getWorld(node);
+	}
+};
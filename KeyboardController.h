@@ -3,6 +3,7 @@
 #include "../Game.h"
 #include "Components.h"
 #include <map>
+#include <memory_resource>
 #include <stdarg.h>
 #include <functional>
 
@@ -10,31 +11,35 @@ class KeyboardController : public Component {
 private:
 	TransformComponent* transform;
 	SpriteComponent* sprite;
+	World* world;
 public:
-	std::map<SDL_KeyCode, std::pair<std::function<void()>, std::function<void()>>> function_keys;
+	std::pmr::map<SDL_KeyCode, std::pair<std::function<void()>, std::function<void()>>> function_keys{ Memory::current() };
 
 	KeyboardController() = default;
 	
 	void init() override {
-		if (!entity->hasComponent<TransformComponent>())
-			entity->addComponent<TransformComponent>();
-		transform = &entity->getComponent<TransformComponent>();
+		world = &entity->getManager().getWorld();
 
-		if (!entity->hasComponent<SpriteComponent>())
-			entity->addComponent<SpriteComponent>();
-		sprite = &entity->getComponent<SpriteComponent>();
+		transform = &entity->require<TransformComponent>();
+
+		sprite = &entity->require<SpriteComponent>();
+	}
+
+	void onRemove() override {
+		entity->release<TransformComponent>();
+		entity->release<SpriteComponent>();
 	}
 
 	void update() override {
-		if (Game::event.type == SDL_KEYDOWN) {
+		if (world->event.type == SDL_KEYDOWN) {
 			for (auto it = function_keys.cbegin(); it != function_keys.cend(); ++it) {
-				if (Game::event.key.keysym.sym == it->first)
+				if (world->event.key.keysym.sym == it->first)
 					((it->second).first)();
 			}
 		}
-		if (Game::event.type == SDL_KEYUP) {
+		if (world->event.type == SDL_KEYUP) {
 			for (auto it = function_keys.cbegin(); it != function_keys.cend(); ++it) {
-				if (Game::event.key.keysym.sym == it->first)
+				if (world->event.key.keysym.sym == it->first)
 					((it->second).second)();
 			}
 		}
@@ -45,8 +50,8 @@ public:
 	/// </summary>
 	/// <param name="quitKey - a value with the SDL_KeyCode data type that is responsible for a specific key on the keyboard"></param>
 	void setQuitKey(SDL_KeyCode quitKey) {
-		function_keys.emplace(quitKey, std::make_pair<std::function<void()>, std::function<void()>>([]() {
-			Game::isRunning = false;
+		function_keys.emplace(quitKey, std::make_pair<std::function<void()>, std::function<void()>>([this]() {
+			world->isRunning = false;
 			}, []() {}));
 	}
 
@@ -68,4 +73,4 @@ public:
 	void setKey(SDL_KeyCode key, std::pair<std::function<void()>, std::function<void()>> keys_down_up) {
 		function_keys.emplace(key, keys_down_up);
 	}
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "Memory.h"
+#include <new>
+#include <cstdlib>
+#include <atomic>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace {
+	// Shared by all threads, so allocations made by workers and the render thread are counted too.
+	std::atomic<std::uint64_t> heapAllocationCount{ 0 };
+}
+
+std::uint64_t Memory::heapAllocations() {
+	return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
+// Define CRYSTAL_COUNT_ALLOCATIONS in the benchmark build to count every operator new call, so frames that allocate can be found with Memory::lastFrame().
+#ifdef CRYSTAL_COUNT_ALLOCATIONS
+
+namespace {
+	// MSVC has no std::aligned_alloc, and memory from _aligned_malloc must be released with _aligned_free, so the aligned operators use these.
+	void* alignedAllocate(std::size_t size, std::size_t alignment) {
+		size = (size ? size : 1) + alignment - 1;
+		size -= size % alignment;
+#ifdef _MSC_VER
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, size);
+#endif
+	}
+
+	void alignedFree(void* p) {
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+void* operator new(std::size_t size) {
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = alignedAllocate(size, static_cast<std::size_t>(alignment)))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	alignedFree(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	alignedFree(p);
+}
+
+#endif
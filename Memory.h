@@ -0,0 +1,256 @@
+#pragma once
+
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Passes allocations to the upstream resource and counts them.
+/// </summary>
+class CountingResource : public std::pmr::memory_resource {
+private:
+	std::pmr::memory_resource* upstream;
+	std::atomic<std::size_t> allocations{ 0 };
+	std::atomic<std::size_t> bytesInUse{ 0 };
+	std::atomic<std::size_t> highWater{ 0 };
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		void* p = upstream->allocate(bytes, alignment);
+		++allocations;
+		std::size_t inUse = bytesInUse += bytes;
+		std::size_t peak = highWater.load(std::memory_order_relaxed);
+		while (inUse > peak && !highWater.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) { }
+		return p;
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+		upstream->deallocate(p, bytes, alignment);
+		bytesInUse -= bytes;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+public:
+	CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) { }
+
+	std::size_t getAllocations() const { return allocations; }
+	std::size_t getBytesInUse() const { return bytesInUse; }
+	std::size_t getHighWater() const { return highWater; }
+};
+
+/// <summary>
+/// Bump allocator for data that lives until the end of the frame. Deallocation does nothing; the whole arena is rewound
+/// at Manager::refresh. After the first frames it settles on one block large enough for a whole frame and stops allocating.
+/// </summary>
+class FrameArena : public std::pmr::memory_resource {
+private:
+	struct Block {
+		std::byte* data;
+		std::size_t size;
+	};
+
+	struct Finalizer {
+		void (*destroy)(void*);
+		void* object;
+		Finalizer* next;
+	};
+
+	std::vector<Block> blocks;
+	std::size_t current = 0;
+	std::size_t offset = 0;
+	std::size_t used = 0;
+	std::size_t highWater = 0;
+	std::size_t blockSize;
+	Finalizer* finalizers = nullptr;
+	std::mutex mutex;
+
+	void* allocateUnlocked(std::size_t bytes, std::size_t alignment) {
+		while (current < blocks.size()) {
+			Block& b = blocks[current];
+			std::size_t start = (reinterpret_cast<std::uintptr_t>(b.data) + offset + alignment - 1) & ~(alignment - 1);
+			start -= reinterpret_cast<std::uintptr_t>(b.data);
+			if (start + bytes <= b.size) {
+				used += start + bytes - offset;
+				offset = start + bytes;
+				return b.data + start;
+			}
+			++current;
+			offset = 0;
+		}
+
+		std::size_t size = std::max(blockSize, bytes + alignment);
+		blocks.push_back({ static_cast<std::byte*>(::operator new(size)), size });
+		current = blocks.size() - 1;
+		offset = 0;
+		return allocateUnlocked(bytes, alignment);
+	}
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		std::lock_guard<std::mutex> lock(mutex);
+		return allocateUnlocked(bytes, alignment);
+	}
+
+	void do_deallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override { }
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+public:
+	FrameArena(std::size_t blockSize = 64 * 1024) : blockSize(blockSize) { }
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	~FrameArena() {
+		reset();
+		for (auto& b : blocks)
+			::operator delete(b.data);
+	}
+
+	/// <summary>
+	/// Creates an object in the arena. Its destructor is called when the arena is reset.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <param name="...args - parameters of the constructor"></param>
+	/// <returns></returns>
+	template<typename T, typename... TArgs>
+	T* create(TArgs&&... args) {
+		std::lock_guard<std::mutex> lock(mutex);
+		T* object = new (allocateUnlocked(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+		if (!std::is_trivially_destructible<T>::value) {
+			Finalizer* f = static_cast<Finalizer*>(allocateUnlocked(sizeof(Finalizer), alignof(Finalizer)));
+			*f = { [](void* o) { static_cast<T*>(o)->~T(); }, object, finalizers };
+			finalizers = f;
+		}
+		return object;
+	}
+
+	/// <summary>
+	/// Destroys the objects created this frame and rewinds the arena. If the frame needed several blocks, they are replaced by one block of their total size.
+	/// </summary>
+	void reset() {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Finalizer* f = finalizers; f; f = f->next)
+			f->destroy(f->object);
+		finalizers = nullptr;
+
+		if (blocks.size() > 1) {
+			std::size_t total = 0;
+			for (auto& b : blocks) {
+				total += b.size;
+				::operator delete(b.data);
+			}
+			blocks.assign(1, { static_cast<std::byte*>(::operator new(total)), total });
+		}
+
+		highWater = std::max(highWater, used);
+		current = offset = used = 0;
+	}
+
+	std::size_t getBytesUsed() const { return used; }
+	std::size_t getHighWater() const { return std::max(highWater, used); }
+};
+
+/// <summary>
+/// Allocation counters of one frame.
+/// </summary>
+struct FrameStats {
+	std::size_t frameBytes = 0;
+	std::size_t frameHighWater = 0;
+	std::size_t poolAllocations = 0;
+	std::size_t poolBytesInUse = 0;
+	std::size_t poolHighWater = 0;
+	std::uint64_t heapAllocations = 0;
+};
+
+/// <summary>
+/// Memory of one Manager: a per-frame arena and size-class pools for long-lived containers.
+/// Components take the pools from Memory::current() while they are being added to an entity.
+/// </summary>
+class Memory {
+private:
+	CountingResource heap{ std::pmr::new_delete_resource() };
+	std::pmr::synchronized_pool_resource sizeClasses{ &heap };
+	CountingResource pools{ &sizeClasses };
+	FrameArena frame;
+
+	FrameStats last;
+	std::size_t poolAllocationsAtStart = 0;
+	std::uint64_t heapAllocationsAtStart = 0;
+
+	static std::pmr::memory_resource*& currentResource() {
+		thread_local std::pmr::memory_resource* resource = nullptr;
+		return resource;
+	}
+public:
+	/// <summary>
+	/// Makes the resource current on this thread for the lifetime of the scope.
+	/// </summary>
+	class Scope {
+	private:
+		std::pmr::memory_resource* previous;
+	public:
+		Scope(std::pmr::memory_resource* resource) : previous(currentResource()) {
+			currentResource() = resource;
+		}
+
+		~Scope() {
+			currentResource() = previous;
+		}
+	};
+
+	Memory() = default;
+	Memory(const Memory&) = delete;
+	Memory& operator=(const Memory&) = delete;
+
+	/// <summary>
+	/// Returns the resource of the manager whose entity is being given a component, or the default resource.
+	/// </summary>
+	/// <returns></returns>
+	static std::pmr::memory_resource* current() {
+		std::pmr::memory_resource* resource = currentResource();
+		return resource ? resource : std::pmr::get_default_resource();
+	}
+
+	/// <summary>
+	/// Returns the number of operator new calls made by all threads. Counted only when Memory.cpp is built with CRYSTAL_COUNT_ALLOCATIONS.
+	/// </summary>
+	/// <returns></returns>
+	static std::uint64_t heapAllocations();
+
+	std::pmr::memory_resource* getPools() { return &pools; }
+	FrameArena& getFrame() { return frame; }
+
+	/// <summary>
+	/// Stores the counters of the frame that has ended and rewinds the frame arena.
+	/// </summary>
+	void endFrame() {
+		last.frameBytes = frame.getBytesUsed();
+		last.frameHighWater = frame.getHighWater();
+		last.poolAllocations = pools.getAllocations() - poolAllocationsAtStart;
+		last.poolBytesInUse = pools.getBytesInUse();
+		last.poolHighWater = pools.getHighWater();
+		last.heapAllocations = heapAllocations() - heapAllocationsAtStart;
+
+		frame.reset();
+		poolAllocationsAtStart = pools.getAllocations();
+		heapAllocationsAtStart = heapAllocations();
+	}
+
+	/// <summary>
+	/// Returns the counters of the last finished frame.
+	/// </summary>
+	/// <returns></returns>
+	const FrameStats& lastFrame() const { return last; }
+
+	std::size_t getPoolBytesReserved() const { return heap.getBytesInUse(); }
+};
\ No newline at end of file
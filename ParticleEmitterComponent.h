@@ -0,0 +1,281 @@
+#pragma once
+
+#include "Components.h"
+#include "../TextureManager.h"
+#include "../Game.h"
+#include "SDL.h"
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+
+struct ParticleSettings {
+	float rate = 100.0f;
+	float lifeMin = 0.5f, lifeMax = 1.0f;
+	float speedMin = 20.0f, speedMax = 60.0f;
+	float angle = 0.0f, spread = 360.0f;
+	float gravityX = 0.0f, gravityY = 0.0f;
+	float sizeStart = 8.0f, sizeEnd = 0.0f;
+	SDL_Color colorStart = { 255, 255, 255, 255 };
+	SDL_Color colorEnd = { 255, 255, 255, 0 };
+};
+
+class ParticleEmitterComponent : public Component {
+private:
+	SDL_Texture* texture = nullptr;
+	bool ownsTexture = true;
+	SDL_Rect textureRect = { 0, 0, 0, 0 };
+	TransformComponent* transform;
+	World* world;
+
+	std::size_t capacity;
+	std::size_t count = 0;
+
+	// Particle data is stored as separate arrays so the simulation loops run over contiguous floats.
+	std::vector<float> posX, posY, velX, velY, age, invLife;
+
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	float spawnDebt = 0.0f;
+	float lastStep = 0.0f;
+	Uint32 lastTicks = 0;
+	std::uint32_t seed = 0x9E3779B9u;
+	bool emitting = true;
+
+	float random(float min, float max) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return min + (max - min) * static_cast<float>(seed & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+	}
+
+	void spawn(float x, float y) {
+		if (count == capacity)
+			return;
+
+		const float toRadians = 3.14159265f / 180.0f;
+		float a = (settings.angle + random(-0.5f, 0.5f) * settings.spread) * toRadians;
+		float s = random(settings.speedMin, settings.speedMax);
+
+		posX[count] = x;
+		posY[count] = y;
+		velX[count] = std::cos(a) * s;
+		velY[count] = std::sin(a) * s;
+		age[count] = 0.0f;
+		invLife[count] = 1.0f / random(settings.lifeMin, settings.lifeMax);
+		++count;
+	}
+
+	void kill(std::size_t i) {
+		--count;
+		posX[i] = posX[count];
+		posY[i] = posY[count];
+		velX[i] = velX[count];
+		velY[i] = velY[count];
+		age[i] = age[count];
+		invLife[i] = invLife[count];
+	}
+
+	static Uint8 mix(Uint8 from, Uint8 to, float t) {
+		return static_cast<Uint8>(from + (to - from) * t);
+	}
+
+public:
+	ParticleSettings settings;
+
+	/// <summary>
+	/// Creates an emitter with a fixed pool of particles. No memory is allocated after construction.
+	/// </summary>
+	/// <param name="path - the path to the particle texture, or nullptr for plain colored squares or a texture set later with setTex"></param>
+	/// <param name="capacity - the maximum number of live particles"></param>
+	ParticleEmitterComponent(const char* path, std::size_t capacity) {
+		this->capacity = capacity;
+
+		if (path) {
+			assert(RenderResources::isRendererThread() && "textures must be loaded on the thread that owns the renderer");
+			texture = TextureManager::LoadTexture(path);
+		}
+		if (texture)
+			SDL_QueryTexture(texture, nullptr, nullptr, &textureRect.w, &textureRect.h);
+
+		posX.resize(capacity);
+		posY.resize(capacity);
+		velX.resize(capacity);
+		velY.resize(capacity);
+		age.resize(capacity);
+		invLife.resize(capacity);
+
+		vertices.resize(capacity * 4);
+		indices.resize(capacity * 6);
+		for (std::size_t i = 0; i < capacity; ++i) {
+			int v = static_cast<int>(i * 4);
+			int* q = &indices[i * 6];
+			q[0] = v; q[1] = v + 1; q[2] = v + 2;
+			q[3] = v + 2; q[4] = v + 3; q[5] = v;
+
+			vertices[i * 4 + 0].tex_coord = { 0.0f, 0.0f };
+			vertices[i * 4 + 1].tex_coord = { 1.0f, 0.0f };
+			vertices[i * 4 + 2].tex_coord = { 1.0f, 1.0f };
+			vertices[i * 4 + 3].tex_coord = { 0.0f, 1.0f };
+		}
+	}
+
+	ParticleEmitterComponent(const char* path, std::size_t capacity, const ParticleSettings& settings)
+		: ParticleEmitterComponent(path, capacity) {
+		this->settings = settings;
+	}
+
+	~ParticleEmitterComponent() {
+		if (ownsTexture)
+			RenderResources::destroyTexture(texture);
+	}
+
+	/// <summary>
+	/// Sets a particle texture owned by someone else, for example by Assets. Emitters drawn by a RenderThread should take their texture this way.
+	/// </summary>
+	/// <param name="sharedTexture - the texture, or nullptr for plain colored squares"></param>
+	void setTex(SDL_Texture* sharedTexture) {
+		if (ownsTexture)
+			RenderResources::destroyTexture(texture);
+		texture = sharedTexture;
+		ownsTexture = false;
+		textureRect = { 0, 0, 0, 0 };
+		if (texture)
+			SDL_QueryTexture(texture, nullptr, nullptr, &textureRect.w, &textureRect.h);
+	}
+
+	void init() override {
+		world = &entity->getManager().getWorld();
+
+		transform = &entity->require<TransformComponent>();
+
+		lastTicks = SDL_GetTicks();
+		seed ^= static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(this) >> 4) | 1u;
+	}
+
+	void onRemove() override {
+		entity->release<TransformComponent>();
+	}
+
+	void update() override {
+		Uint32 ticks = SDL_GetTicks();
+		float dt = std::min((ticks - lastTicks) / 1000.0f, 0.1f);
+		lastTicks = ticks;
+		lastStep = dt;
+
+		if (emitting) {
+			float originX = transform->position.x + transform->width * transform->scale / 2.0f;
+			float originY = transform->position.y + transform->height * transform->scale / 2.0f;
+			spawnDebt += settings.rate * dt;
+			for (; spawnDebt >= 1.0f; spawnDebt -= 1.0f)
+				spawn(originX, originY);
+		}
+
+		const float gx = settings.gravityX * dt, gy = settings.gravityY * dt;
+		float* px = posX.data();
+		float* py = posY.data();
+		float* vx = velX.data();
+		float* vy = velY.data();
+		float* ag = age.data();
+		const std::size_t n = count;
+
+		for (std::size_t i = 0; i < n; ++i) {
+			vx[i] += gx;
+			vy[i] += gy;
+			px[i] += vx[i] * dt;
+			py[i] += vy[i] * dt;
+			ag[i] += dt;
+		}
+
+		for (std::size_t i = 0; i < count;) {
+			if (age[i] * invLife[i] >= 1.0f)
+				kill(i);
+			else
+				++i;
+		}
+	}
+
+	void draw() override {
+		if (count == 0)
+			return;
+
+		const float camX = static_cast<float>(world->camera.x);
+		const float camY = static_cast<float>(world->camera.y);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			float t = age[i] * invLife[i];
+			float half = (settings.sizeStart + (settings.sizeEnd - settings.sizeStart) * t) / 2.0f;
+			float x = posX[i] - camX, y = posY[i] - camY;
+
+			SDL_Color color = {
+				mix(settings.colorStart.r, settings.colorEnd.r, t),
+				mix(settings.colorStart.g, settings.colorEnd.g, t),
+				mix(settings.colorStart.b, settings.colorEnd.b, t),
+				mix(settings.colorStart.a, settings.colorEnd.a, t)
+			};
+
+			SDL_Vertex* v = &vertices[i * 4];
+			v[0].position = { x - half, y - half };
+			v[1].position = { x + half, y - half };
+			v[2].position = { x + half, y + half };
+			v[3].position = { x - half, y + half };
+			v[0].color = v[1].color = v[2].color = v[3].color = color;
+		}
+
+		SDL_RenderGeometry(Game::renderer, texture, vertices.data(), static_cast<int>(count * 4),
+			indices.data(), static_cast<int>(count * 6));
+	}
+
+	/// <summary>
+	/// Publishes every live particle as a colored item that moves from where it was before the last update.
+	/// </summary>
+	void publish(RenderSnapshot& snapshot, Group layer) override {
+		for (std::size_t i = 0; i < count; ++i) {
+			float t = age[i] * invLife[i];
+			int size = static_cast<int>(settings.sizeStart + (settings.sizeEnd - settings.sizeStart) * t);
+			if (size <= 0)
+				continue;
+
+			SDL_Rect previous = { static_cast<int>(posX[i] - velX[i] * lastStep) - size / 2, static_cast<int>(posY[i] - velY[i] * lastStep) - size / 2, size, size };
+			SDL_Rect current = { static_cast<int>(posX[i]) - size / 2, static_cast<int>(posY[i]) - size / 2, size, size };
+			SDL_Color color = {
+				mix(settings.colorStart.r, settings.colorEnd.r, t),
+				mix(settings.colorStart.g, settings.colorEnd.g, t),
+				mix(settings.colorStart.b, settings.colorEnd.b, t),
+				mix(settings.colorStart.a, settings.colorEnd.a, t)
+			};
+			snapshot.items.push_back({ texture, textureRect, previous, current, SDL_FLIP_NONE, layer, color });
+		}
+	}
+
+	/// <summary>
+	/// Spawns a number of particles at once, for example for an explosion.
+	/// </summary>
+	/// <param name="amount - the number of particles; the rest is dropped if the pool is full"></param>
+	void burst(std::size_t amount) {
+		float originX = transform->position.x + transform->width * transform->scale / 2.0f;
+		float originY = transform->position.y + transform->height * transform->scale / 2.0f;
+		for (std::size_t i = 0; i < amount; ++i)
+			spawn(originX, originY);
+	}
+
+	/// <summary>
+	/// Starts or stops the continuous emission. Live particles keep flying.
+	/// </summary>
+	/// <param name="emit - true to emit particles at settings.rate"></param>
+	void setEmitting(bool emit) {
+		emitting = emit;
+		spawnDebt = 0.0f;
+	}
+
+	/// <summary>
+	/// Kills all live particles.
+	/// </summary>
+	void clear() {
+		count = 0;
+	}
+
+	std::size_t getCount() const { return count; }
+	std::size_t getCapacity() const { return capacity; }
+};
@@ -8,12 +8,11 @@
 #include "../Game.h"
 #include "Manifold.h"
 
-extern Manager manager;
-
 class PhysicsComponent : public Component {
 private:
-	TransformComponent* transform;
-	float mass, inv_mass, restitution;
+	TransformComponent* transform = nullptr;
+	World* world;
+	float mass = 0, inv_mass = 0, restitution = 0;
 
 	std::vector<std::size_t> conflictingGroups;
 
@@ -36,90 +35,58 @@ public:
 	}
 	
 	void init() override {
+		world = &entity->getManager().getWorld();
+
 		if (!entity->hasComponent<TransformComponent>()) {
 			std::cout << "[PhysicsComponent] ERROR: the entity doesn't have TransformComponent!" << std::endl;
-			Game::isRunning = false;
+			world->isRunning = false;
+			return;
 		}
-		transform = &entity->getComponent<TransformComponent>();
-
-		mass = inv_mass = restitution = 0;
+		transform = &entity->require<TransformComponent>();
 	}
 
 	void update() override {
 		for (auto& g : conflictingGroups) {
-			for (auto& e : manager.getGroup(g)) {
+			for (auto& e : world->manager.getGroup(g)) {
+				if (e == entity || !e->hasComponent<PhysicsComponent>())
+					continue;
+
+				TransformComponent& other = e->getComponent<TransformComponent>();
+				PhysicsComponent* body = &e->getComponent<PhysicsComponent>();
 				Manifold man;
 				man.B = e;
-				if (this->transform->radius != 0 && e->getComponent<TransformComponent>().radius != 0) {
-					if (CirclevsCircle(&man)) {
-						ResolveCollision(&man);
-						PositionalCorrection(&man);
-					}
-				}
-				if (this->transform->radius == 0 && e->getComponent<TransformComponent>().radius == 0) {
-					if (AABBvsAABB(&man)) {
-						ResolveCollision(&man);
-						PositionalCorrection(&man);
-					}
-				}
-				if (this->transform->radius == 0 && e->getComponent<TransformComponent>().radius != 0) {
-					if (AABBvsCircle(&man)) {
-						ResolveCollision(&man);
-						PositionalCorrection(&man);
-					}
-				}
-				if (this->transform->radius != 0 && e->getComponent<TransformComponent>().radius == 0) {
-					man.B = this->entity;
-					transform = &e->getComponent<TransformComponent>();
-					AABBvsCircle(&man);
-					ResolveCollision(&man);
-					PositionalCorrection(&man);
-					transform = &this->entity->getComponent<TransformComponent>();
+
+				if (transform->radius != 0 && other.radius != 0) {
+					if (CirclevsCircle(*transform, other, &man))
+						world->physics.report(this, body, man);
+				} else if (transform->radius == 0 && other.radius == 0) {
+					if (AABBvsAABB(*transform, other, &man))
+						world->physics.report(this, body, man);
+				} else if (transform->radius == 0) {
+					if (AABBvsCircle(*transform, other, &man))
+						world->physics.report(this, body, man);
+				} else {
+					man.B = entity;
+					if (AABBvsCircle(other, *transform, &man))
+						world->physics.report(body, this, man);
 				}
 			}
 		}
 	}
 
-	void ResolveCollision(Manifold* m) {
-		Vector2D rv = m->B->getComponent<TransformComponent>().velocity - transform->velocity;
-
-		float velAlongNormal = Vector2D::DotProduct(rv, m->normal);
-
-		if (velAlongNormal > 0)
-			return;
-
-		float e = std::min(this->restitution, m->B->getComponent<PhysicsComponent>().restitution);
-
-		float j = -(1 + e) * velAlongNormal;
-		j /= (this->inv_mass + m->B->getComponent<PhysicsComponent>().inv_mass);
-
-		Vector2D impulse = m->normal * j;
-		
-		float mass_sum = this->mass + m->B->getComponent<PhysicsComponent>().mass;
-
-		float ratio = this->mass / mass_sum;
-		transform->velocity -= impulse * ratio;
-
-		ratio = 1 - ratio;
-		m->B->getComponent<TransformComponent>().velocity += impulse * ratio;
-	}
-
-	void PositionalCorrection(Manifold* m) {
-		const float percent = 0.2f;
-		const float slop = 0.01f;
-
-		Vector2D correction = m->normal * (std::max(m->penetration - slop, 0.0f) / (this->inv_mass
-			+ m->B->getComponent<PhysicsComponent>().inv_mass) * percent);
-
-		transform->position -= correction * this->inv_mass;
-
-		m->B->getComponent<TransformComponent>().position += correction * m->B->getComponent<PhysicsComponent>().inv_mass;
+	void onRemove() override {
+		world->physics.removeBody(this);
+		if (transform)
+			entity->release<TransformComponent>();
 	}
 
-	bool CirclevsCircle(Manifold* m) {
-		Vector2D AB = m->B->getComponent<TransformComponent>().position - transform->position;
+	/// <summary>
+	/// Finds the contact of two circles. The normal points from a to b.
+	/// </summary>
+	static bool CirclevsCircle(const TransformComponent& a, const TransformComponent& b, Manifold* m) {
+		Vector2D AB = b.position - a.position;
 
-		float r = transform->radius + m->B->getComponent<TransformComponent>().radius;
+		float r = a.radius + b.radius;
 
 		if (AB.LengthSquared() > r * r)
 			return false;
@@ -130,29 +97,49 @@ public:
 			m->penetration = r - d;
 			m->normal = AB / d;
 		} else {
-			m->penetration = transform->radius;
+			m->penetration = a.radius;
 			m->normal = Vector2D(1, 0);
 		}
 
 		return true;
 	}
 	
-	bool AABBvsAABB(Manifold* m) {
-		Vector2D AB = m->B->getComponent<TransformComponent>().position - transform->position;
+	/// <summary>
+	/// Returns the half size of a box. Like the collider and the scene, a box covers width * scale by height * scale pixels from its position.
+	/// </summary>
+	static Vector2D BoxExtent(const TransformComponent& box) {
+		return Vector2D(box.width * box.scale / 2.0f, box.height * box.scale / 2.0f);
+	}
 
-		float a_extent = transform->width / 2.0f;
-		float b_extent = m->B->getComponent<TransformComponent>().width / 2.0f;
+	/// <summary>
+	/// Returns the center of a box, whose position is its top left corner.
+	/// </summary>
+	static Vector2D BoxCenter(const TransformComponent& box) {
+		Vector2D extent = BoxExtent(box);
+		return Vector2D(box.position.x + extent.x, box.position.y + extent.y);
+	}
+
+	/// <summary>
+	/// Finds the contact of two boxes. The normal points from a to b.
+	/// </summary>
+	static bool AABBvsAABB(const TransformComponent& a, const TransformComponent& b, Manifold* m) {
+		Vector2D AB = BoxCenter(b) - BoxCenter(a);
+		Vector2D a_size = BoxExtent(a);
+		Vector2D b_size = BoxExtent(b);
+
+		float a_extent = a_size.x;
+		float b_extent = b_size.x;
 
 		float x_overlap = a_extent + b_extent - std::abs(AB.x);
 
 		if (x_overlap > 0) {
-			a_extent = transform->height / 2.0f;
-			b_extent = m->B->getComponent<TransformComponent>().height / 2.0f;
+			a_extent = a_size.y;
+			b_extent = b_size.y;
 
 			float y_overlap = a_extent + b_extent - std::abs(AB.y);
 			
 			if (y_overlap > 0) {
-				if (x_overlap > y_overlap) {
+				if (x_overlap < y_overlap) {
 					if (AB.x < 0)
 						m->normal = Vector2D(-1, 0);
 					else
@@ -171,23 +158,29 @@ public:
 		return false;
 	}
 
-	bool AABBvsCircle(Manifold* m) {
-		Vector2D AB = m->B->getComponent<TransformComponent>().position - transform->position;
+	/// <summary>
+	/// Finds the contact of a box and a circle. The normal points from the box to the circle. The position of a circle is its center.
+	/// </summary>
+	static bool AABBvsCircle(const TransformComponent& box, const TransformComponent& circle, Manifold* m) {
+		Vector2D AB = circle.position - BoxCenter(box);
 
 		Vector2D closest = AB;
 
-		float x_extent = transform->width / 2.0f;
-		float y_extent = transform->height / 2.0f;
+		Vector2D extent = BoxExtent(box);
+		float x_extent = extent.x;
+		float y_extent = extent.y;
 
 		closest.x = Clamp(-x_extent, x_extent, closest.x);
 		closest.y = Clamp(-y_extent, y_extent, closest.y);
 
 		bool inside = false;
+		bool xAxis = false;
 
 		if (AB == closest) {
 			inside = true;
+			xAxis = x_extent - std::abs(AB.x) < y_extent - std::abs(AB.y);
 
-			if (std::abs(AB.x) > std::abs(AB.y)) {
+			if (xAxis) {
 				if (closest.x > 0)
 					closest.x = x_extent;
 				else
@@ -203,23 +196,30 @@ public:
 
 		Vector2D normal = AB - closest;
 		float d = normal.LengthSquared();
-		float r = m->B->getComponent<TransformComponent>().radius;
+		float r = circle.radius;
 
-		if (d > r * r && inside)
+		if (d > r * r && !inside)
 			return false;
 
 		d = std::sqrt(d);
 
-		if (inside)
-			m->normal = Vector2D(-1 * AB.x, -1 * AB.y);
+		// Inside the box the circle is pushed out through the nearest edge, also when its center lies on that edge.
+		if (d == 0)
+			m->normal = xAxis ? Vector2D(closest.x > 0 ? 1.0f : -1.0f, 0) : Vector2D(0, closest.y > 0 ? 1.0f : -1.0f);
+		else if (inside)
+			m->normal = normal / -d;
 		else
-			m->normal = AB;
+			m->normal = normal / d;
 
-		m->penetration = r - d;
+		m->penetration = inside ? r + d : r - d;
 
 		return true;
 	}
 
+	TransformComponent& getTransform() { return *transform; }
+	float getInvMass() const { return inv_mass; }
+	float getRestitution() const { return restitution; }
+
 	void setConstants(float mass, float restitution) {
 		this->mass = mass;
 
@@ -241,11 +241,11 @@ public:
 	}
 
 	void setConflictingGroups(int am_groups, ...) {
-		conflictingGroups.resize(am_groups);
+		conflictingGroups.clear();
 		va_list argGroups;
 		va_start(argGroups, am_groups);
 		for (size_t i = 0; i < am_groups; ++i)
 			conflictingGroups.push_back(va_arg(argGroups, std::size_t));
 		va_end(argGroups);
 	}
-};
\ No newline at end of file
+};
\ No newline at end of file
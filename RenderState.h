@@ -0,0 +1,173 @@
+#pragma once
+
+#include "SDL.h"
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Everything the renderer needs to draw one sprite. Rectangles are in world coordinates, so the renderer can interpolate them.
+/// An item without a texture is drawn as a rectangle filled with its color; otherwise the color modulates the texture.
+/// </summary>
+struct RenderItem {
+	SDL_Texture* texture;
+	SDL_Rect src;
+	SDL_Rect previous, current;
+	SDL_RendererFlip flip;
+	std::size_t layer;
+	SDL_Color color = { 255, 255, 255, 255 };
+};
+
+/// <summary>
+/// Render data of one simulation tick. Items are stored in drawing order.
+/// </summary>
+struct RenderSnapshot {
+	std::vector<RenderItem> items;
+	SDL_Rect previousCamera = { 0, 0, 0, 0 };
+	SDL_Rect camera = { 0, 0, 0, 0 };
+	std::uint64_t tick = 0;
+	std::chrono::steady_clock::time_point time;
+	float tickSeconds = 1.0f / 60.0f;
+
+	void clear() {
+		items.clear();
+	}
+};
+
+/// <summary>
+/// Tracks which thread may use Game::renderer. SDL renderers are not thread-safe, so while a RenderThread runs, textures are created
+/// and destroyed only on it; without one, the thread that created the renderer owns them. Textures owned by components are released
+/// with destroyTexture, which keeps them alive until the render thread has moved past every snapshot that can refer to them.
+/// </summary>
+class RenderResources {
+private:
+	struct Retired {
+		SDL_Texture* texture;
+		std::uint64_t tick;
+	};
+
+	std::mutex mutex;
+	std::vector<Retired> retired;
+	std::atomic<std::thread::id> rendererThread{ std::thread::id() };
+	std::atomic<std::uint64_t> publishedTick{ 0 };
+
+	static RenderResources& instance() {
+		static RenderResources resources;
+		return resources;
+	}
+public:
+	/// <summary>
+	/// Returns true if the calling thread may create, draw and destroy textures: the render thread while one runs, otherwise any thread.
+	/// </summary>
+	/// <returns></returns>
+	static bool isRendererThread() {
+		std::thread::id owner = instance().rendererThread.load(std::memory_order_acquire);
+		return owner == std::thread::id() || owner == std::this_thread::get_id();
+	}
+
+	/// <summary>
+	/// Destroys the texture now if there is no render thread, or on the render thread once it draws a snapshot published after this call.
+	/// </summary>
+	/// <param name="texture - the texture, may be nullptr"></param>
+	static void destroyTexture(SDL_Texture* texture) {
+		if (!texture)
+			return;
+
+		RenderResources& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.rendererThread.load(std::memory_order_acquire) == std::thread::id())
+			SDL_DestroyTexture(texture);
+		else
+			r.retired.push_back({ texture, r.publishedTick.load(std::memory_order_acquire) });
+	}
+
+	/// <summary>
+	/// Notes the tick of a snapshot handed to the renderer. Called by RenderBuffer::publish.
+	/// </summary>
+	static void published(std::uint64_t tick) {
+		instance().publishedTick.store(tick, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// Makes the calling thread the owner of the renderer. Called by RenderThread when it starts.
+	/// </summary>
+	static void beginRendering() {
+		instance().rendererThread.store(std::this_thread::get_id(), std::memory_order_release);
+	}
+
+	/// <summary>
+	/// Destroys the textures retired before the snapshot that is drawn now. Called by the render thread.
+	/// </summary>
+	/// <param name="drawnTick - the tick of the snapshot being drawn"></param>
+	static void collect(std::uint64_t drawnTick) {
+		RenderResources& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::size_t kept = 0;
+		for (auto& t : r.retired) {
+			if (t.tick < drawnTick)
+				SDL_DestroyTexture(t.texture);
+			else
+				r.retired[kept++] = t;
+		}
+		r.retired.resize(kept);
+	}
+
+	/// <summary>
+	/// Destroys all retired textures and gives the renderer back to any thread. Called by the render thread when it stops.
+	/// </summary>
+	static void endRendering() {
+		RenderResources& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (auto& t : r.retired)
+			SDL_DestroyTexture(t.texture);
+		r.retired.clear();
+		r.rendererThread.store(std::thread::id(), std::memory_order_release);
+	}
+};
+
+/// <summary>
+/// Triple buffer between the simulation and the render thread. The simulation always has a snapshot to write into,
+/// the renderer always has a complete snapshot to read from, and neither waits for the other.
+/// Textures referenced by published snapshots must stay alive while the renderer can draw them, so rendered worlds should take textures from Assets.
+/// </summary>
+class RenderBuffer {
+private:
+	static constexpr int freshBit = 4;
+
+	RenderSnapshot snapshots[3];
+	int writeIndex = 0;
+	int readIndex = 1;
+	std::atomic<int> readyIndex{ 2 };
+public:
+	/// <summary>
+	/// Returns the snapshot the simulation writes into. Only the simulation thread may call it.
+	/// </summary>
+	/// <returns></returns>
+	RenderSnapshot& beginWrite() {
+		RenderSnapshot& s = snapshots[writeIndex];
+		s.clear();
+		return s;
+	}
+
+	/// <summary>
+	/// Hands the written snapshot over to the renderer.
+	/// </summary>
+	void publish() {
+		RenderResources::published(snapshots[writeIndex].tick);
+		writeIndex = readyIndex.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+	}
+
+	/// <summary>
+	/// Returns the newest published snapshot. Only the render thread may call it.
+	/// </summary>
+	/// <returns></returns>
+	const RenderSnapshot& acquire() {
+		if (readyIndex.load(std::memory_order_relaxed) & freshBit)
+			readIndex = readyIndex.exchange(readIndex, std::memory_order_acq_rel) & ~freshBit;
+		return snapshots[readIndex];
+	}
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "RenderState.h"
+#include "../TextureManager.h"
+#include "../Game.h"
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+
+/// <summary>
+/// Draws the snapshots published by the simulation on its own thread, interpolating between the last two ticks.
+///
+/// While it runs, the render thread owns Game::renderer: textures are created only on it, for example loaded into Assets by the setup
+/// function, and components take them from there. Creating a texture on another thread asserts (see RenderResources::isRendererThread).
+/// Components that own a texture release it with RenderResources::destroyTexture, so a snapshot never refers to a destroyed texture.
+/// </summary>
+class RenderThread {
+private:
+	RenderBuffer& buffer;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	static int lerp(int from, int to, float t) {
+		return from + static_cast<int>((to - from) * t + (to >= from ? 0.5f : -0.5f));
+	}
+
+	void run(std::function<void()> setup) {
+		RenderResources::beginRendering();
+		if (setup)
+			setup();
+
+		while (running.load(std::memory_order_relaxed)) {
+			const RenderSnapshot& snapshot = buffer.acquire();
+			if (snapshot.tick == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - snapshot.time;
+			float alpha = std::min(elapsed.count() / snapshot.tickSeconds, 1.0f);
+			RenderResources::collect(snapshot.tick);
+
+			SDL_RenderClear(Game::renderer);
+			draw(snapshot, alpha);
+			SDL_RenderPresent(Game::renderer);
+		}
+
+		RenderResources::endRendering();
+	}
+public:
+	RenderThread(RenderBuffer& renderBuffer) : buffer(renderBuffer) { }
+
+	~RenderThread() {
+		stop();
+	}
+
+	/// <summary>
+	/// Starts the render thread.
+	/// </summary>
+	/// <param name="setup - a function called on the render thread before the first frame, for example to create the renderer"></param>
+	void start(std::function<void()> setup = nullptr) {
+		if (running.exchange(true))
+			return;
+		thread = std::thread(&RenderThread::run, this, std::move(setup));
+	}
+
+	/// <summary>
+	/// Stops the render thread and waits for the current frame to finish.
+	/// </summary>
+	void stop() {
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	/// <summary>
+	/// Draws the snapshot, placing every item between its previous and current position.
+	/// </summary>
+	/// <param name="snapshot - the snapshot"></param>
+	/// <param name="alpha - 0 draws the previous tick, 1 draws the current tick"></param>
+	static void draw(const RenderSnapshot& snapshot, float alpha) {
+		assert(RenderResources::isRendererThread() && "snapshots must be drawn on the thread that owns the renderer");
+		int camX = lerp(snapshot.previousCamera.x, snapshot.camera.x, alpha);
+		int camY = lerp(snapshot.previousCamera.y, snapshot.camera.y, alpha);
+
+		for (auto& item : snapshot.items) {
+			SDL_Rect dst = {
+				lerp(item.previous.x, item.current.x, alpha) - camX,
+				lerp(item.previous.y, item.current.y, alpha) - camY,
+				item.current.w,
+				item.current.h
+			};
+
+			const SDL_Color& c = item.color;
+			if (!item.texture) {
+				SDL_SetRenderDrawColor(Game::renderer, c.r, c.g, c.b, c.a);
+				SDL_RenderFillRect(Game::renderer, &dst);
+			} else if (c.r != 255 || c.g != 255 || c.b != 255 || c.a != 255) {
+				SDL_SetTextureColorMod(item.texture, c.r, c.g, c.b);
+				SDL_SetTextureAlphaMod(item.texture, c.a);
+				TextureManager::Draw(item.texture, item.src, dst, item.flip);
+				SDL_SetTextureColorMod(item.texture, 255, 255, 255);
+				SDL_SetTextureAlphaMod(item.texture, 255);
+			} else {
+				TextureManager::Draw(item.texture, item.src, dst, item.flip);
+			}
+		}
+	}
+};
@@ -5,12 +5,16 @@
 #include "SDL.h"
 #include "Animation.h"
 #include <map>
+#include <cassert>
 
 class SpriteComponent : public Component {
 private:
-	SDL_Texture* texture;
+	SDL_Texture* texture = nullptr;
+	bool ownsTexture = true;
+	const AnimationTable* sharedAnimations = nullptr;
 	SDL_Rect destRect, srcRect;
 	TransformComponent* transform;
+	World* world;
 
 	bool animated = false;
 	int frames = 0;
@@ -18,7 +22,7 @@ private:
 
 public:
 	int animIndex = 0;
-	std::map<const char*, Animation> animations;
+	AnimationTable animations{ Memory::current() };
 	SDL_RendererFlip spriteFlip = SDL_FLIP_NONE;
 
 	SpriteComponent() = default;
@@ -44,6 +48,16 @@ public:
 		spriteFlip = flip;
 	}
 
+	/// <summary>
+	/// Creates a sprite that draws a texture owned by someone else, for example by Assets. The texture is not destroyed with the sprite.
+	/// </summary>
+	/// <param name="sharedTexture - the texture"></param>
+	/// <param name="isAnimated - true if the texture contains animation frames"></param>
+	SpriteComponent(SDL_Texture* sharedTexture, bool isAnimated = false) {
+		animated = isAnimated;
+		setTex(sharedTexture);
+	}
+
 	/// <summary>
 	/// Runs a standard animation, the index of which is 0, the number of frames is 4, and the speed is 100.
 	/// </summary>
@@ -54,13 +68,14 @@ public:
 	}
 
 	~SpriteComponent() {
-		SDL_DestroyTexture(texture);
+		if (ownsTexture)
+			RenderResources::destroyTexture(texture);
 	}
 
 	void init() override {
-		if (!entity->hasComponent<TransformComponent>())
-			entity->addComponent<TransformComponent>();
-		transform = &entity->getComponent<TransformComponent>();
+		world = &entity->getManager().getWorld();
+
+		transform = &entity->require<TransformComponent>();
 
 		srcRect.x = static_cast<int>(transform->src_pos.x);
 		srcRect.y = static_cast<int>(transform->src_pos.y);
@@ -68,28 +83,65 @@ public:
 		srcRect.h = transform->height;
 	}
 
+	void onRemove() override {
+		entity->release<TransformComponent>();
+	}
+
 	void update() override {
 		if (animated) {
 			srcRect.x = srcRect.w * static_cast<int>((SDL_GetTicks() / speed) % frames);
 			srcRect.y = animIndex * transform->height;
 		}
+	}
 
-		destRect.x = static_cast<int>(transform->position.x) - Game::camera.x;
-		destRect.y = static_cast<int>(transform->position.y) - Game::camera.y;
+	void draw() override {
+		// The destination is taken at draw time, after attached entities have followed their parents.
+		destRect.x = static_cast<int>(transform->position.x) - world->camera.x;
+		destRect.y = static_cast<int>(transform->position.y) - world->camera.y;
 		destRect.w = transform->width * transform->scale;
 		destRect.h = transform->height * transform->scale;
-	}
 
-	void draw() override {
 		TextureManager::Draw(texture, srcRect, destRect, spriteFlip);
 	}
 
+	void publish(RenderSnapshot& snapshot, Group layer) override {
+		int w = transform->width * transform->scale;
+		int h = transform->height * transform->scale;
+		SDL_Rect previous = { static_cast<int>(transform->past_position.x), static_cast<int>(transform->past_position.y), w, h };
+		SDL_Rect current = { static_cast<int>(transform->position.x), static_cast<int>(transform->position.y), w, h };
+
+		snapshot.items.push_back({ texture, srcRect, previous, current, spriteFlip, layer });
+	}
+
 	/// <summary>
-	/// Sets a new texture.
+	/// Sets a new texture. It is loaded on the calling thread, so sprites drawn by a RenderThread should take textures from Assets instead.
 	/// </summary>
 	/// <param name="path - the path to the texture"></param>
 	void setTex(const char* path) {
+		assert(RenderResources::isRendererThread() && "textures must be loaded on the thread that owns the renderer");
+		if (ownsTexture)
+			RenderResources::destroyTexture(texture);
 		texture = TextureManager::LoadTexture(path);
+		ownsTexture = true;
+	}
+
+	/// <summary>
+	/// Sets a texture owned by someone else, for example by Assets.
+	/// </summary>
+	/// <param name="sharedTexture - the texture"></param>
+	void setTex(SDL_Texture* sharedTexture) {
+		if (ownsTexture)
+			RenderResources::destroyTexture(texture);
+		texture = sharedTexture;
+		ownsTexture = false;
+	}
+
+	/// <summary>
+	/// Uses a shared animation table instead of the sprite's own animations.
+	/// </summary>
+	/// <param name="table - the table, for example from Assets::getAnimationTable; nullptr returns to the own animations"></param>
+	void useAnimations(const AnimationTable* table) {
+		sharedAnimations = table;
 	}
 
 	/// <summary>
@@ -97,9 +149,14 @@ public:
 	/// </summary>
 	/// <param name="animName - animation name"></param>
 	void Play(const char* animName) {
-		frames = animations[animName].frames;
-		speed = animations[animName].speed;
-		animIndex = animations[animName].index;
+		const AnimationTable& table = sharedAnimations ? *sharedAnimations : animations;
+		auto it = table.find(animName);
+		if (it == table.end())
+			return;
+
+		frames = it->second.frames;
+		speed = it->second.speed;
+		animIndex = it->second.index;
 	}
 
 	/// <summary>
@@ -112,4 +169,4 @@ public:
 	void addAnimation(const char* name, int i, int f, int s) {
 		animations.emplace(name, Animation(i, f, s));
 	}
-};
\ No newline at end of file
+};
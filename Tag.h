@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+using TagID = std::uint32_t;
+
+/// <summary>
+/// The tag of entities that have not been tagged.
+/// </summary>
+constexpr TagID noTag = 0;
+
+/// <summary>
+/// Process-wide symbol table of tags. Each name is stored once and given a small integer, so tags are compared as integers
+/// and can index arrays. Interning is thread-safe; the names are never removed, so the returned references stay valid.
+/// </summary>
+class Tags {
+private:
+	std::mutex mutex;
+	std::unordered_map<std::string_view, TagID> ids;
+	std::deque<std::string> names{ std::string() };
+
+	static Tags& table() {
+		static Tags tags;
+		return tags;
+	}
+public:
+	/// <summary>
+	/// Returns the ID of the name, adding the name to the table if it is new. The empty name is noTag.
+	/// </summary>
+	/// <param name="name - the tag name"></param>
+	/// <returns></returns>
+	static TagID intern(std::string_view name) {
+		if (name.empty())
+			return noTag;
+
+		Tags& t = table();
+		std::lock_guard<std::mutex> lock(t.mutex);
+		auto it = t.ids.find(name);
+		if (it != t.ids.end())
+			return it->second;
+
+		TagID id = static_cast<TagID>(t.names.size());
+		t.names.emplace_back(name);
+		t.ids.emplace(t.names.back(), id);
+		return id;
+	}
+
+	/// <summary>
+	/// Returns the ID of the name without adding it to the table.
+	/// </summary>
+	/// <param name="name - the tag name"></param>
+	/// <returns>noTag if the name has never been interned</returns>
+	static TagID find(std::string_view name) {
+		if (name.empty())
+			return noTag;
+
+		Tags& t = table();
+		std::lock_guard<std::mutex> lock(t.mutex);
+		auto it = t.ids.find(name);
+		return it != t.ids.end() ? it->second : noTag;
+	}
+
+	/// <summary>
+	/// Returns the name of the tag.
+	/// </summary>
+	/// <param name="id - the tag returned by intern"></param>
+	/// <returns></returns>
+	static const std::string& name(TagID id) {
+		Tags& t = table();
+		std::lock_guard<std::mutex> lock(t.mutex);
+		return t.names[id];
+	}
+
+	/// <summary>
+	/// Returns the number of tags interned so far, including noTag.
+	/// </summary>
+	/// <returns></returns>
+	static std::size_t count() {
+		Tags& t = table();
+		std::lock_guard<std::mutex> lock(t.mutex);
+		return t.names.size();
+	}
+};
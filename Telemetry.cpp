@@ -0,0 +1,111 @@
+#include "Telemetry.h"
+#include <algorithm>
+
+namespace {
+	void writeString(std::ostream& out, const char* s) {
+		out << '"';
+		for (; s && *s; ++s) {
+			if (*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+}
+
+void Manager::collectStats(ManagerStats& stats) const {
+	std::array<std::size_t, maxComponents> counts{};
+
+	stats.tick = tick;
+	stats.entities = entities.size();
+	stats.entityBytes = 0;
+	stats.archetypes.clear();
+
+	for (auto& e : entities) {
+		const ComponentBitSet& types = e->getComponentTypes();
+		std::size_t bytes = e->footprint();
+		stats.entityBytes += bytes;
+
+		for (ComponentID id = 0; id < maxComponents; ++id)
+			if (types[id])
+				++counts[id];
+
+		auto it = std::find_if(stats.archetypes.begin(), stats.archetypes.end(),
+			[&types](const ArchetypeStats& a) { return a.components == types; });
+		if (it == stats.archetypes.end())
+			stats.archetypes.push_back({ types, 1, bytes });
+		else {
+			++it->count;
+			it->bytes += bytes;
+		}
+	}
+
+	std::sort(stats.archetypes.begin(), stats.archetypes.end(),
+		[](const ArchetypeStats& a, const ArchetypeStats& b) { return a.bytes > b.bytes; });
+
+	stats.components.clear();
+	auto& types = componentTypes();
+	for (ComponentID id = 0; id < maxComponents; ++id)
+		if (counts[id])
+			stats.components.push_back({ id, types[id].name.c_str(), types[id].size, counts[id], counts[id] * types[id].size });
+
+	stats.groups.clear();
+	for (Group g = 0; g < maxGroups; ++g) {
+		std::size_t count = 0, bytes = 0;
+		for (auto e : groupedEntities[g]) {
+			if (!e->isActive() || !e->hasGroup(g))
+				continue;
+			++count;
+			bytes += e->footprint();
+		}
+		if (count)
+			stats.groups.push_back({ g, count, bytes });
+	}
+
+	stats.memory = memory.lastFrame();
+	stats.poolBytesReserved = memory.getPoolBytesReserved();
+	stats.churn = lastChurn;
+}
+
+void Manager::dumpStats(std::ostream& out) const {
+	ManagerStats stats;
+	collectStats(stats);
+	stats.writeJSON(out);
+}
+
+void ManagerStats::writeJSON(std::ostream& out) const {
+	out << "{\"tick\":" << tick << ",\"entities\":" << entities << ",\"entityBytes\":" << entityBytes;
+
+	out << ",\"components\":[";
+	for (std::size_t i = 0; i < components.size(); ++i) {
+		const ComponentTypeStats& c = components[i];
+		out << (i ? "," : "") << "{\"id\":" << c.id << ",\"type\":";
+		writeString(out, c.name);
+		out << ",\"size\":" << c.size << ",\"count\":" << c.count << ",\"bytes\":" << c.bytes << '}';
+	}
+
+	out << "],\"groups\":[";
+	for (std::size_t i = 0; i < groups.size(); ++i)
+		out << (i ? "," : "") << "{\"group\":" << groups[i].group << ",\"count\":" << groups[i].count << ",\"bytes\":" << groups[i].bytes << '}';
+
+	out << "],\"archetypes\":[";
+	for (std::size_t i = 0; i < archetypes.size(); ++i) {
+		out << (i ? "," : "") << "{\"components\":[";
+		bool first = true;
+		for (ComponentID id = 0; id < maxComponents; ++id) {
+			if (!archetypes[i].components[id])
+				continue;
+			out << (first ? "" : ",") << id;
+			first = false;
+		}
+		out << "],\"count\":" << archetypes[i].count << ",\"bytes\":" << archetypes[i].bytes << '}';
+	}
+
+	out << "],\"memory\":{\"frameBytes\":" << memory.frameBytes << ",\"frameHighWater\":" << memory.frameHighWater
+		<< ",\"poolAllocations\":" << memory.poolAllocations << ",\"poolBytesInUse\":" << memory.poolBytesInUse
+		<< ",\"poolHighWater\":" << memory.poolHighWater << ",\"poolBytesReserved\":" << poolBytesReserved
+		<< ",\"heapAllocations\":" << memory.heapAllocations << '}';
+
+	out << ",\"churn\":{\"created\":" << churn.created << ",\"destroyed\":" << churn.destroyed << ",\"regrouped\":" << churn.regrouped
+		<< ",\"componentsAdded\":" << churn.componentsAdded << ",\"componentsRemoved\":" << churn.componentsRemoved << "}}\n";
+}
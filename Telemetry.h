@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ECS.h"
+#include <vector>
+#include <ostream>
+
+struct ComponentTypeStats {
+	ComponentID id;
+	const char* name;
+	std::size_t size;
+	std::size_t count;
+	std::size_t bytes;
+};
+
+struct GroupStats {
+	Group group;
+	std::size_t count;
+	std::size_t bytes;
+};
+
+/// <summary>
+/// Entities that have exactly the same component types.
+/// </summary>
+struct ArchetypeStats {
+	ComponentBitSet components;
+	std::size_t count;
+	std::size_t bytes;
+};
+
+/// <summary>
+/// Snapshot of a manager filled by Manager::collectStats. Bytes are the sizes of entities and components themselves;
+/// memory the components allocate from the manager's pools is reported in memory.poolBytesInUse.
+/// </summary>
+struct ManagerStats {
+	std::uint64_t tick = 0;
+	std::size_t entities = 0;
+	std::size_t entityBytes = 0;
+	std::vector<ComponentTypeStats> components;
+	std::vector<GroupStats> groups;
+	std::vector<ArchetypeStats> archetypes;
+	FrameStats memory;
+	std::size_t poolBytesReserved = 0;
+	ChurnStats churn;
+
+	/// <summary>
+	/// Returns the statistics of the component type specified in the template, or nullptr if there are no such components.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	/// <returns></returns>
+	template<typename T>
+	const ComponentTypeStats* component() const {
+		ComponentID id = getComponentTypeID<T>();
+		for (auto& c : components)
+			if (c.id == id)
+				return &c;
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Returns the statistics of the group, or nullptr if the group is empty.
+	/// </summary>
+	/// <param name="mGroup - entity group number"></param>
+	/// <returns></returns>
+	const GroupStats* group(Group mGroup) const {
+		for (auto& g : groups)
+			if (g.group == mGroup)
+				return &g;
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Writes the statistics as one line of JSON.
+	/// </summary>
+	/// <param name="out - the stream"></param>
+	void writeJSON(std::ostream& out) const;
+};
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "Components.h"
+#include "../TextureManager.h"
+#include "../Game.h"
+#include "SDL.h"
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <cassert>
+
+using TileIndex = std::uint16_t;
+
+class TileMapComponent : public Component {
+public:
+	static constexpr TileIndex emptyTile = 0xFFFF;
+	static constexpr int chunkTiles = 16;
+
+private:
+	struct Chunk {
+		std::vector<TileIndex> tiles;
+		SDL_Texture* cache = nullptr;
+		bool dirty = true;
+	};
+
+	SDL_Texture* atlas = nullptr;
+	bool ownsAtlas = true;
+	int atlasColumns = 1;
+	int tileSize, scale;
+	int width, height;
+	int chunksX, chunksY;
+	bool isStatic;
+
+	std::vector<Chunk> chunks;
+	std::vector<bool> solid;
+
+	int firstChunkX = 0, firstChunkY = 0, lastChunkX = -1, lastChunkY = -1;
+
+	TransformComponent* transform;
+	World* world;
+
+	Chunk& chunkAt(int tileX, int tileY) {
+		return chunks[(tileY / chunkTiles) * chunksX + tileX / chunkTiles];
+	}
+
+	SDL_Rect tileSrc(TileIndex index) const {
+		return { (index % atlasColumns) * tileSize, (index / atlasColumns) * tileSize, tileSize, tileSize };
+	}
+
+	void drawChunkTiles(const Chunk& chunk, int originX, int originY, int tilePx) {
+		for (int y = 0; y < chunkTiles; ++y) {
+			for (int x = 0; x < chunkTiles; ++x) {
+				TileIndex index = chunk.tiles[y * chunkTiles + x];
+				if (index == emptyTile)
+					continue;
+				SDL_Rect dst = { originX + x * tilePx, originY + y * tilePx, tilePx, tilePx };
+				TextureManager::Draw(atlas, tileSrc(index), dst, SDL_FLIP_NONE);
+			}
+		}
+	}
+
+	bool bakeChunk(Chunk& chunk) {
+		assert(RenderResources::isRendererThread() && "chunk caches must be created on the thread that owns the renderer");
+		int px = chunkTiles * tileSize;
+		if (!chunk.cache) {
+			chunk.cache = SDL_CreateTexture(Game::renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, px, px);
+			if (!chunk.cache)
+				return false;
+			SDL_SetTextureBlendMode(chunk.cache, SDL_BLENDMODE_BLEND);
+		}
+
+		SDL_Texture* previous = SDL_GetRenderTarget(Game::renderer);
+		SDL_SetRenderTarget(Game::renderer, chunk.cache);
+		SDL_SetRenderDrawColor(Game::renderer, 0, 0, 0, 0);
+		SDL_RenderClear(Game::renderer);
+		drawChunkTiles(chunk, 0, 0, tileSize);
+		SDL_SetRenderTarget(Game::renderer, previous);
+
+		chunk.dirty = false;
+		return true;
+	}
+
+public:
+	/// <summary>
+	/// Creates a tile map whose tiles are stored as atlas indices in square chunks.
+	/// </summary>
+	/// <param name="atlasPath - the path to the tile atlas texture"></param>
+	/// <param name="tileSize - the size of one tile in the atlas in pixels"></param>
+	/// <param name="mapScale - the scale with which the tiles are drawn"></param>
+	/// <param name="widthInTiles - map width in tiles"></param>
+	/// <param name="heightInTiles - map height in tiles"></param>
+	/// <param name="isStatic - if true, chunks are pre-rendered once and redrawn from the cache"></param>
+	TileMapComponent(const char* atlasPath, int tileSize, int mapScale, int widthInTiles, int heightInTiles, bool isStatic = true)
+		: TileMapComponent(static_cast<SDL_Texture*>(nullptr), tileSize, mapScale, widthInTiles, heightInTiles, isStatic) {
+		assert(RenderResources::isRendererThread() && "textures must be loaded on the thread that owns the renderer");
+		setAtlas(TextureManager::LoadTexture(atlasPath));
+		ownsAtlas = true;
+	}
+
+	/// <summary>
+	/// Creates a tile map that draws an atlas owned by someone else, for example by Assets. Maps drawn by a RenderThread should be created this way.
+	/// </summary>
+	/// <param name="sharedAtlas - the tile atlas texture; it is not destroyed with the map"></param>
+	TileMapComponent(SDL_Texture* sharedAtlas, int tileSize, int mapScale, int widthInTiles, int heightInTiles, bool isStatic = true) {
+		this->tileSize = tileSize;
+		this->isStatic = isStatic;
+		scale = mapScale;
+		width = widthInTiles;
+		height = heightInTiles;
+
+		chunksX = (width + chunkTiles - 1) / chunkTiles;
+		chunksY = (height + chunkTiles - 1) / chunkTiles;
+		chunks.resize(chunksX * chunksY);
+		for (auto& c : chunks)
+			c.tiles.assign(chunkTiles * chunkTiles, emptyTile);
+		solid.assign(width * height, false);
+
+		setAtlas(sharedAtlas);
+	}
+
+	~TileMapComponent() {
+		for (auto& c : chunks)
+			RenderResources::destroyTexture(c.cache);
+		if (ownsAtlas)
+			RenderResources::destroyTexture(atlas);
+	}
+
+	/// <summary>
+	/// Replaces the atlas with one owned by someone else and redraws all chunks.
+	/// </summary>
+	/// <param name="sharedAtlas - the tile atlas texture"></param>
+	void setAtlas(SDL_Texture* sharedAtlas) {
+		if (ownsAtlas)
+			RenderResources::destroyTexture(atlas);
+		atlas = sharedAtlas;
+		ownsAtlas = false;
+
+		int atlasWidth = 0;
+		atlasColumns = 1;
+		if (atlas && SDL_QueryTexture(atlas, nullptr, nullptr, &atlasWidth, nullptr) == 0 && atlasWidth >= tileSize)
+			atlasColumns = atlasWidth / tileSize;
+		invalidate();
+	}
+
+	void init() override {
+		world = &entity->getManager().getWorld();
+
+		transform = &entity->require<TransformComponent>();
+	}
+
+	void onRemove() override {
+		entity->release<TransformComponent>();
+	}
+
+	void update() override {
+		int chunkPx = chunkTiles * tileSize * scale;
+		const SDL_Rect& camera = world->camera;
+		int left = camera.x - static_cast<int>(transform->position.x);
+		int top = camera.y - static_cast<int>(transform->position.y);
+
+		firstChunkX = std::max(0, left / chunkPx);
+		firstChunkY = std::max(0, top / chunkPx);
+		lastChunkX = left + camera.w < 0 ? -1 : std::min(chunksX - 1, (left + camera.w) / chunkPx);
+		lastChunkY = top + camera.h < 0 ? -1 : std::min(chunksY - 1, (top + camera.h) / chunkPx);
+	}
+
+	void draw() override {
+		int chunkPx = chunkTiles * tileSize * scale;
+		int originX = static_cast<int>(transform->position.x) - world->camera.x;
+		int originY = static_cast<int>(transform->position.y) - world->camera.y;
+
+		for (int cy = firstChunkY; cy <= lastChunkY; ++cy) {
+			for (int cx = firstChunkX; cx <= lastChunkX; ++cx) {
+				Chunk& chunk = chunks[cy * chunksX + cx];
+				int x = originX + cx * chunkPx;
+				int y = originY + cy * chunkPx;
+
+				if (isStatic && (!chunk.dirty || bakeChunk(chunk))) {
+					SDL_Rect src = { 0, 0, chunkTiles * tileSize, chunkTiles * tileSize };
+					SDL_Rect dst = { x, y, chunkPx, chunkPx };
+					TextureManager::Draw(chunk.cache, src, dst, SDL_FLIP_NONE);
+				} else {
+					drawChunkTiles(chunk, x, y, tileSize * scale);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Publishes the visible tiles one by one, since the chunk caches belong to the renderer of the simulation thread.
+	/// </summary>
+	void publish(RenderSnapshot& snapshot, Group layer) override {
+		if (!atlas)
+			return;
+
+		int tilePx = tileSize * scale;
+		int originX = static_cast<int>(transform->position.x);
+		int originY = static_cast<int>(transform->position.y);
+
+		for (int cy = firstChunkY; cy <= lastChunkY; ++cy) {
+			for (int cx = firstChunkX; cx <= lastChunkX; ++cx) {
+				const Chunk& chunk = chunks[cy * chunksX + cx];
+				for (int y = 0; y < chunkTiles; ++y) {
+					for (int x = 0; x < chunkTiles; ++x) {
+						TileIndex index = chunk.tiles[y * chunkTiles + x];
+						if (index == emptyTile)
+							continue;
+						SDL_Rect rect = { originX + (cx * chunkTiles + x) * tilePx, originY + (cy * chunkTiles + y) * tilePx, tilePx, tilePx };
+						snapshot.items.push_back({ atlas, tileSrc(index), rect, rect, SDL_FLIP_NONE, layer });
+					}
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Sets the atlas index of the tile. Pass emptyTile to clear it.
+	/// </summary>
+	/// <param name="x - tile column"></param>
+	/// <param name="y - tile row"></param>
+	/// <param name="index - index of the tile in the atlas, counted left to right, top to bottom"></param>
+	void setTile(int x, int y, TileIndex index) {
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return;
+		Chunk& chunk = chunkAt(x, y);
+		chunk.tiles[(y % chunkTiles) * chunkTiles + x % chunkTiles] = index;
+		chunk.dirty = true;
+	}
+
+	/// <summary>
+	/// Returns the atlas index of the tile, or emptyTile if there is none.
+	/// </summary>
+	/// <param name="x - tile column"></param>
+	/// <param name="y - tile row"></param>
+	/// <returns></returns>
+	TileIndex getTile(int x, int y) {
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return emptyTile;
+		return chunkAt(x, y).tiles[(y % chunkTiles) * chunkTiles + x % chunkTiles];
+	}
+
+	/// <summary>
+	/// Marks the tile as solid or passable for collision queries.
+	/// </summary>
+	/// <param name="x - tile column"></param>
+	/// <param name="y - tile row"></param>
+	/// <param name="isSolid - true if the tile blocks movement"></param>
+	void setSolid(int x, int y, bool isSolid) {
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return;
+		solid[y * width + x] = isSolid;
+	}
+
+	/// <summary>
+	/// Returns true if the tile is solid. Tiles outside the map are passable.
+	/// </summary>
+	/// <param name="x - tile column"></param>
+	/// <param name="y - tile row"></param>
+	/// <returns></returns>
+	bool isSolid(int x, int y) const {
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return false;
+		return solid[y * width + x];
+	}
+
+	/// <summary>
+	/// Returns true if the rectangle in world coordinates overlaps at least one solid tile.
+	/// </summary>
+	/// <param name="rect - the rectangle, for example ColliderComponent::collider"></param>
+	/// <returns></returns>
+	bool collides(const SDL_Rect& rect) const {
+		int tilePx = tileSize * scale;
+		int left = rect.x - static_cast<int>(transform->position.x);
+		int top = rect.y - static_cast<int>(transform->position.y);
+		if (rect.w <= 0 || rect.h <= 0 || left + rect.w <= 0 || top + rect.h <= 0)
+			return false;
+
+		int x0 = std::max(0, left / tilePx), x1 = std::min(width - 1, (left + rect.w - 1) / tilePx);
+		int y0 = std::max(0, top / tilePx), y1 = std::min(height - 1, (top + rect.h - 1) / tilePx);
+
+		for (int y = y0; y <= y1; ++y)
+			for (int x = x0; x <= x1; ++x)
+				if (solid[y * width + x])
+					return true;
+		return false;
+	}
+
+	/// <summary>
+	/// Collects world rectangles of all solid tiles overlapped by the rectangle.
+	/// </summary>
+	/// <param name="rect - the rectangle in world coordinates"></param>
+	/// <param name="out - the vector to which the tile rectangles are appended"></param>
+	void solidTilesIn(const SDL_Rect& rect, std::vector<SDL_Rect>& out) const {
+		int tilePx = tileSize * scale;
+		int originX = static_cast<int>(transform->position.x);
+		int originY = static_cast<int>(transform->position.y);
+		int left = rect.x - originX, top = rect.y - originY;
+		if (rect.w <= 0 || rect.h <= 0 || left + rect.w <= 0 || top + rect.h <= 0)
+			return;
+
+		int x0 = std::max(0, left / tilePx), x1 = std::min(width - 1, (left + rect.w - 1) / tilePx);
+		int y0 = std::max(0, top / tilePx), y1 = std::min(height - 1, (top + rect.h - 1) / tilePx);
+
+		for (int y = y0; y <= y1; ++y)
+			for (int x = x0; x <= x1; ++x)
+				if (solid[y * width + x])
+					out.push_back({ originX + x * tilePx, originY + y * tilePx, tilePx, tilePx });
+	}
+
+	/// <summary>
+	/// Marks all cached chunks for re-rendering, for example after the renderer has lost its render targets.
+	/// </summary>
+	void invalidate() {
+		for (auto& c : chunks)
+			c.dirty = true;
+	}
+
+	/// <summary>
+	/// Loads the map from a file with two blocks of comma-separated values: the tile indices (-1 for an empty tile) and then the collision flags (0 or 1).
+	/// </summary>
+	/// <param name="path - the path to the map file"></param>
+	/// <returns></returns>
+	bool loadMap(const char* path) {
+		std::ifstream mapFile(path);
+		if (!mapFile.is_open()) {
+			std::cout << "[TileMapComponent] ERROR: can't open the map " << path << std::endl;
+			return false;
+		}
+
+		auto next = [&mapFile](int& value) {
+			if (!(mapFile >> value))
+				return false;
+			if (mapFile.peek() == ',')
+				mapFile.ignore();
+			return true;
+		};
+
+		int value;
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				if (next(value))
+					setTile(x, y, value < 0 ? emptyTile : static_cast<TileIndex>(value));
+
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				if (next(value))
+					setSolid(x, y, value != 0);
+
+		return true;
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getTileSize() const { return tileSize * scale; }
+};
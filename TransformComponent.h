@@ -17,6 +17,8 @@ public:
 	float radius = 0;
 
 	int speed = 3;
+
+	ProxyID sceneProxy = AABBTree::nullProxy;
 	
 	// Overloads for individual textures
 
@@ -101,6 +103,16 @@ public:
 
 	void init() override {
 		velocity.Zero();
+		past_position = position;
+
+		// Circle bodies are found by scene queries through the transform; rectangles through their ColliderComponent.
+		if (radius != 0)
+			sceneProxy = entity->getManager().getWorld().scene.createProxy(entity, &position, &radius);
+	}
+
+	void onRemove() override {
+		if (sceneProxy != AABBTree::nullProxy)
+			entity->getManager().getWorld().scene.destroyProxy(sceneProxy);
 	}
 
 	void update() override {
@@ -109,4 +121,4 @@ public:
 		position.x += velocity.x * speed;
 		position.y += velocity.y * speed;
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,17 @@
+#include "Components.h"
+
+float World::distanceToCamera(Entity& e) const {
+	if (!e.hasComponent<TransformComponent>())
+		return 0.0f;
+
+	const TransformComponent& t = e.getComponent<TransformComponent>();
+	float x = t.position.x, y = t.position.y;
+	if (t.radius == 0) {
+		x += t.width * t.scale / 2.0f;
+		y += t.height * t.scale / 2.0f;
+	}
+
+	float dx = x - (camera.x + camera.w / 2.0f);
+	float dy = y - (camera.y + camera.h / 2.0f);
+	return dx * dx + dy * dy;
+}
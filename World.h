@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ECS.h"
+#include "RenderState.h"
+#include "AABBTree.h"
+#include "ContactSolver.h"
+#include "SDL.h"
+
+class Assets;
+
+/// <summary>
+/// One independent simulation: the entities with their physics state, the camera and the input of the world.
+/// Several worlds can run in one process, each on its own thread, and share immutable Assets.
+/// </summary>
+class World {
+private:
+	SDL_Rect publishedCamera = { 0, 0, 0, 0 };
+	std::uint64_t tick = 0;
+public:
+	AABBTree scene;
+	ContactSolver physics;
+	Manager manager;
+	SDL_Rect camera = { 0, 0, 0, 0 };
+	SDL_Event event = {};
+	bool isRunning = true;
+	Assets* assets;
+
+	World(Assets* sharedAssets = nullptr) : assets(sharedAssets) {
+		manager.setWorld(this);
+		manager.setFocusDistance([this](Entity& e) { return distanceToCamera(e); });
+	}
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	/// <summary>
+	/// Returns the squared distance from the center of the camera to the center of the entity, or 0 if the entity has no TransformComponent.
+	/// </summary>
+	/// <param name="e - the entity"></param>
+	/// <returns></returns>
+	float distanceToCamera(Entity& e) const;
+
+	/// <summary>
+	/// Runs one simulation tick: applies the changes of the previous tick, updates all entities, resolves the contacts they reported and refits the scene tree.
+	/// </summary>
+	void update() {
+		manager.refresh();
+		manager.update();
+		physics.solve();
+		scene.refit();
+	}
+
+	/// <summary>
+	/// Publishes the render data of the tick that has just been simulated. Call it after update.
+	/// </summary>
+	/// <param name="buffer - the buffer read by the render thread"></param>
+	/// <param name="tickSeconds - duration of one simulation tick, used to interpolate between ticks"></param>
+	void publish(RenderBuffer& buffer, float tickSeconds) {
+		RenderSnapshot& snapshot = buffer.beginWrite();
+		snapshot.previousCamera = tick == 0 ? camera : publishedCamera;
+		snapshot.camera = publishedCamera = camera;
+		snapshot.tick = ++tick;
+		snapshot.tickSeconds = tickSeconds;
+		snapshot.time = std::chrono::steady_clock::now();
+
+		manager.publish(snapshot);
+		buffer.publish();
+	}
+};
@@ -0,0 +1,431 @@
+#include "Components.h"
+#include "WorldStreamer.h"
+#include <cstring>
+#include <cmath>
+#include <exception>
+
+namespace {
+	constexpr char streamMagic[4] = { 'C', 'R', 'W', 'S' };
+	constexpr std::uint32_t streamVersion = 1;
+	constexpr std::size_t headerSize = 4 + 4 + 6 * 4;
+	constexpr std::size_t tableEntrySize = 8 + 4;
+	// type, group, x, y and the size of the extra data.
+	constexpr std::size_t recordSize = 2 + 2 + 4 + 4 + 2;
+
+	template<std::size_t Size> struct Unsigned;
+	template<> struct Unsigned<1> { using type = std::uint8_t; };
+	template<> struct Unsigned<2> { using type = std::uint16_t; };
+	template<> struct Unsigned<4> { using type = std::uint32_t; };
+	template<> struct Unsigned<8> { using type = std::uint64_t; };
+
+	// Values are written and read byte by byte in little-endian order, so the files are the same on every host.
+	template<typename T>
+	void store(std::uint8_t* out, T value) {
+		typename Unsigned<sizeof(T)>::type bits;
+		std::memcpy(&bits, &value, sizeof(T));
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+			out[i] = static_cast<std::uint8_t>(bits >> (8 * i));
+	}
+
+	template<typename T>
+	void put(std::vector<std::uint8_t>& out, T value) {
+		out.resize(out.size() + sizeof(T));
+		store(out.data() + out.size() - sizeof(T), value);
+	}
+
+	template<typename T>
+	bool get(const std::uint8_t*& p, const std::uint8_t* end, T& value) {
+		using Bits = typename Unsigned<sizeof(T)>::type;
+		if (static_cast<std::size_t>(end - p) < sizeof(T))
+			return false;
+		Bits bits = 0;
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+			bits |= static_cast<Bits>(static_cast<Bits>(p[i]) << (8 * i));
+		std::memcpy(&value, &bits, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+}
+
+void StreamedComponent::onRemove() {
+	if (streamer)
+		streamer->forget(cell, slot);
+}
+
+WorldStreamer::WorldStreamer(World& world, const char* path) : world(world), path(path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "[WorldStreamer] ERROR: can't open the stream " << path << std::endl;
+		return;
+	}
+
+	file.seekg(0, std::ios::end);
+	std::uint64_t length = static_cast<std::uint64_t>(file.tellg());
+	file.seekg(0);
+
+	std::uint8_t header[headerSize];
+	const std::uint8_t* p = header;
+	const std::uint8_t* end = header + headerSize;
+	std::uint32_t version = 0;
+	std::int32_t values[6];
+
+	if (!file.read(reinterpret_cast<char*>(header), headerSize) || std::memcmp(header, streamMagic, 4) != 0) {
+		std::cout << "[WorldStreamer] ERROR: " << path << " is not a stream file" << std::endl;
+		return;
+	}
+	p += 4;
+	get(p, end, version);
+	for (auto& v : values)
+		get(p, end, v);
+
+	layout = { values[0], values[1], values[2], values[3], values[4], values[5] };
+	if (version != streamVersion || layout.cellSize <= 0 || layout.cellsX <= 0 || layout.cellsY <= 0 || layout.cellTiles < 0) {
+		std::cout << "[WorldStreamer] ERROR: unsupported stream " << path << std::endl;
+		return;
+	}
+
+	std::size_t count = static_cast<std::size_t>(layout.cellsX) * layout.cellsY;
+	if (count > (length - headerSize) / tableEntrySize) {
+		std::cout << "[WorldStreamer] ERROR: the cell table of " << path << " is truncated" << std::endl;
+		return;
+	}
+
+	std::vector<std::uint8_t> buffer(count * tableEntrySize);
+	if (!file.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
+		std::cout << "[WorldStreamer] ERROR: the cell table of " << path << " is truncated" << std::endl;
+		return;
+	}
+
+	table.resize(count);
+	p = buffer.data();
+	end = p + buffer.size();
+	for (auto& t : table) {
+		get(p, end, t.offset);
+		get(p, end, t.size);
+		// Cells are read on the loader thread, so their sizes are checked here rather than trusted there.
+		if (t.offset > length || t.size > length - t.offset) {
+			std::cout << "[WorldStreamer] ERROR: the cell table of " << path << " points past the end of the file" << std::endl;
+			table.clear();
+			return;
+		}
+	}
+
+	open = true;
+	loader = std::thread(&WorldStreamer::loaderLoop, this);
+}
+
+WorldStreamer::~WorldStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (loader.joinable())
+		loader.join();
+
+	for (auto& c : cells)
+		for (Entity* e : c.second.entities)
+			e->getComponent<StreamedComponent>().streamer = nullptr;
+}
+
+void WorldStreamer::registerFactory(EntityType type, EntityFactory factory) {
+	if (factories.size() <= type)
+		factories.resize(type + 1);
+	factories[type] = std::move(factory);
+}
+
+void WorldStreamer::setRadius(int loadCells, int evictCells) {
+	loadRadius = std::max(0, loadCells);
+	evictRadius = std::max(loadRadius, evictCells);
+}
+
+std::size_t WorldStreamer::residentCells() const {
+	std::size_t count = 0;
+	for (auto& c : cells)
+		if (c.second.state == CellState::Resident)
+			++count;
+	return count;
+}
+
+void WorldStreamer::loaderLoop() {
+	std::ifstream file(path, std::ios::binary);
+
+	for (;;) {
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+			if (stopping)
+				return;
+			request = requests.front();
+			requests.pop_front();
+		}
+
+		std::unique_ptr<CellBatch> batch(new CellBatch());
+		batch->cellX = keyX(request.key);
+		batch->cellY = keyY(request.key);
+		bool valid;
+		try {
+			valid = readCell(file, request.key, *batch);
+		} catch (const std::exception&) {
+			valid = false;
+		}
+
+		if (!valid) {
+			std::cout << "[WorldStreamer] ERROR: cell " << batch->cellX << ", " << batch->cellY << " of " << path << " is damaged" << std::endl;
+			int x = batch->cellX, y = batch->cellY;
+			batch.reset(new CellBatch());
+			batch->cellX = x;
+			batch->cellY = y;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		loaded.push_back({ request.key, request.generation, std::move(batch) });
+	}
+}
+
+bool WorldStreamer::readCell(std::ifstream& file, std::uint64_t k, CellBatch& batch) const {
+	const TableEntry& entry = table[static_cast<std::size_t>(keyY(k)) * layout.cellsX + keyX(k)];
+	if (entry.size == 0)
+		return true;
+
+	std::vector<std::uint8_t> buffer(entry.size);
+	file.clear();
+	file.seekg(static_cast<std::streamoff>(entry.offset));
+	if (!file.read(reinterpret_cast<char*>(buffer.data()), buffer.size()))
+		return false;
+
+	const std::uint8_t* p = buffer.data();
+	const std::uint8_t* end = p + buffer.size();
+
+	std::uint32_t count;
+	if (!get(p, end, count))
+		return false;
+
+	if (count > static_cast<std::size_t>(end - p) / recordSize)
+		return false;
+
+	batch.records.reserve(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		EntityRecord r;
+		if (!get(p, end, r.type) || !get(p, end, r.group) || !get(p, end, r.x) || !get(p, end, r.y) || !get(p, end, r.dataSize))
+			return false;
+		if (static_cast<std::size_t>(end - p) < r.dataSize)
+			return false;
+
+		r.dataOffset = static_cast<std::uint32_t>(batch.data.size());
+		batch.data.insert(batch.data.end(), p, p + r.dataSize);
+		p += r.dataSize;
+		batch.records.push_back(r);
+	}
+
+	if (layout.cellTiles > 0) {
+		std::size_t n = static_cast<std::size_t>(layout.cellTiles) * layout.cellTiles;
+		if (n > static_cast<std::size_t>(end - p) / sizeof(std::uint16_t))
+			return false;
+
+		batch.tiles.resize(n);
+		for (auto& t : batch.tiles)
+			if (!get(p, end, t))
+				return false;
+
+		if (static_cast<std::size_t>(end - p) < (n + 7) / 8)
+			return false;
+		batch.solid.resize(n);
+		for (std::size_t i = 0; i < n; ++i)
+			batch.solid[i] = (p[i / 8] >> (i % 8)) & 1;
+	}
+
+	return true;
+}
+
+void WorldStreamer::sync() {
+	if (!open)
+		return;
+
+	const SDL_Rect& camera = world.camera;
+	int cx = static_cast<int>(std::floor((camera.x + camera.w / 2.0f - layout.originX) / layout.cellSize));
+	int cy = static_cast<int>(std::floor((camera.y + camera.h / 2.0f - layout.originY) / layout.cellSize));
+
+	for (auto it = cells.begin(); it != cells.end();) {
+		if (std::max(std::abs(keyX(it->first) - cx), std::abs(keyY(it->first) - cy)) > evictRadius) {
+			evict(it->second, it->first);
+			it = cells.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	wanted.clear();
+	for (int y = std::max(0, cy - loadRadius); y <= std::min(layout.cellsY - 1, cy + loadRadius); ++y) {
+		for (int x = std::max(0, cx - loadRadius); x <= std::min(layout.cellsX - 1, cx + loadRadius); ++x) {
+			std::uint64_t k = key(x, y);
+			if (cells.find(k) == cells.end())
+				wanted.emplace_back((x - cx) * (x - cx) + (y - cy) * (y - cy), k);
+		}
+	}
+	std::sort(wanted.begin(), wanted.end());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.erase(std::remove_if(requests.begin(), requests.end(),
+			[this](const Request& r) {
+				auto it = cells.find(r.key);
+				return it == cells.end() || it->second.generation != r.generation;
+			}), requests.end());
+
+		for (auto& w : wanted) {
+			Cell& cell = cells[w.second];
+			cell.generation = ++nextGeneration;
+			requests.push_back({ w.second, cell.generation });
+		}
+
+		arrived.swap(loaded);
+	}
+	if (!wanted.empty())
+		wake.notify_one();
+
+	for (auto& l : arrived) {
+		auto it = cells.find(l.key);
+		if (it == cells.end() || it->second.generation != l.generation)
+			continue;
+
+		Cell& cell = it->second;
+		cell.batch = std::move(l.batch);
+		cell.cursor = 0;
+		cell.state = CellState::Committing;
+		if (tileMap && layout.cellTiles > 0)
+			applyTiles(keyX(l.key), keyY(l.key), cell.batch.get());
+	}
+	arrived.clear();
+
+	std::size_t budget = commitBudget;
+	for (auto& c : cells) {
+		if (budget == 0)
+			break;
+		if (c.second.state == CellState::Committing)
+			budget -= commit(c.second, c.first, budget);
+	}
+}
+
+std::size_t WorldStreamer::commit(Cell& cell, std::uint64_t k, std::size_t budget) {
+	const CellBatch& batch = *cell.batch;
+	std::size_t created = 0;
+
+	while (cell.cursor < batch.records.size() && created < budget) {
+		const EntityRecord& r = batch.records[cell.cursor++];
+		if (r.type >= factories.size() || !factories[r.type])
+			continue;
+
+		Entity& e = world.manager.addEntity();
+		StreamedComponent& streamed = e.addComponent<StreamedComponent>();
+		streamed.streamer = this;
+		streamed.cell = k;
+		streamed.slot = cell.entities.size();
+		cell.entities.push_back(&e);
+
+		factories[r.type](e, r, batch.recordData(r));
+		if (r.group != noStreamGroup)
+			e.addGroup(r.group);
+		++created;
+	}
+
+	if (cell.cursor == batch.records.size()) {
+		cell.state = CellState::Resident;
+		cell.batch.reset();
+	}
+	return created;
+}
+
+void WorldStreamer::evict(Cell& cell, std::uint64_t k) {
+	for (Entity* e : cell.entities) {
+		e->getComponent<StreamedComponent>().streamer = nullptr;
+		e->destroy();
+	}
+	cell.entities.clear();
+
+	if (tileMap && layout.cellTiles > 0 && cell.state != CellState::Requested)
+		applyTiles(keyX(k), keyY(k), nullptr);
+}
+
+void WorldStreamer::forget(std::uint64_t cellKey, std::size_t slot) {
+	auto it = cells.find(cellKey);
+	if (it == cells.end())
+		return;
+
+	auto& list = it->second.entities;
+	Entity* last = list.back();
+	list[slot] = last;
+	last->getComponent<StreamedComponent>().slot = slot;
+	list.pop_back();
+}
+
+void WorldStreamer::applyTiles(int cellX, int cellY, const CellBatch* batch) {
+	int n = layout.cellTiles;
+	for (int ty = 0; ty < n; ++ty) {
+		for (int tx = 0; tx < n; ++tx) {
+			int x = cellX * n + tx, y = cellY * n + ty;
+			std::size_t i = static_cast<std::size_t>(ty) * n + tx;
+			if (batch && i < batch->tiles.size()) {
+				tileMap->setTile(x, y, batch->tiles[i]);
+				tileMap->setSolid(x, y, batch->solid[i] != 0);
+			} else {
+				tileMap->setTile(x, y, TileMapComponent::emptyTile);
+				tileMap->setSolid(x, y, false);
+			}
+		}
+	}
+}
+
+bool WorldStreamer::save(const char* path, const StreamLayout& layout, const std::vector<CellBatch>& cells) {
+	if (layout.cellSize <= 0 || layout.cellsX <= 0 || layout.cellsY <= 0 || layout.cellTiles < 0)
+		return false;
+
+	std::size_t count = static_cast<std::size_t>(layout.cellsX) * layout.cellsY;
+	std::vector<std::uint8_t> out(streamMagic, streamMagic + 4);
+	put(out, streamVersion);
+	for (std::int32_t v : { layout.cellSize, layout.cellsX, layout.cellsY, layout.originX, layout.originY, layout.cellTiles })
+		put(out, v);
+
+	std::size_t tableStart = out.size();
+	out.resize(tableStart + count * tableEntrySize, 0);
+
+	for (auto& c : cells) {
+		if (c.cellX < 0 || c.cellY < 0 || c.cellX >= layout.cellsX || c.cellY >= layout.cellsY)
+			continue;
+
+		std::uint64_t start = out.size();
+		put(out, static_cast<std::uint32_t>(c.records.size()));
+		for (auto& r : c.records) {
+			put(out, r.type);
+			put(out, r.group);
+			put(out, r.x);
+			put(out, r.y);
+			put(out, r.dataSize);
+			out.insert(out.end(), c.data.begin() + r.dataOffset, c.data.begin() + r.dataOffset + r.dataSize);
+		}
+
+		if (layout.cellTiles > 0) {
+			std::size_t n = static_cast<std::size_t>(layout.cellTiles) * layout.cellTiles;
+			for (std::size_t i = 0; i < n; ++i)
+				put(out, i < c.tiles.size() ? c.tiles[i] : TileMapComponent::emptyTile);
+
+			std::size_t bits = out.size();
+			out.resize(bits + (n + 7) / 8, 0);
+			for (std::size_t i = 0; i < n && i < c.solid.size(); ++i)
+				if (c.solid[i])
+					out[bits + i / 8] |= static_cast<std::uint8_t>(1 << (i % 8));
+		}
+
+		std::uint32_t size = static_cast<std::uint32_t>(out.size() - start);
+		std::uint8_t* entry = out.data() + tableStart + (static_cast<std::size_t>(c.cellY) * layout.cellsX + c.cellX) * tableEntrySize;
+		store(entry, start);
+		store(entry + sizeof(start), size);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.write(reinterpret_cast<const char*>(out.data()), out.size());
+	return static_cast<bool>(file);
+}
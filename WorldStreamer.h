@@ -0,0 +1,246 @@
+#pragma once
+
+#include "ECS.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+
+class World;
+class TileMapComponent;
+class WorldStreamer;
+
+using EntityType = std::uint16_t;
+
+/// <summary>
+/// The group of records whose entities are not added to any group.
+/// </summary>
+constexpr std::uint16_t noStreamGroup = 0xFFFF;
+
+/// <summary>
+/// One entity as stored in a cell. The factory registered for the type turns it into components.
+/// </summary>
+struct EntityRecord {
+	EntityType type;
+	std::uint16_t group;
+	float x, y;
+	std::uint32_t dataOffset;
+	std::uint16_t dataSize;
+};
+
+/// <summary>
+/// The contents of one cell: entity records with their extra data and, if the file has tiles, the tiles of the cell.
+/// </summary>
+struct CellBatch {
+	int cellX = 0, cellY = 0;
+	std::vector<EntityRecord> records;
+	std::vector<std::uint8_t> data;
+	std::vector<std::uint16_t> tiles;
+	std::vector<std::uint8_t> solid;
+
+	/// <summary>
+	/// Returns the extra data of the record.
+	/// </summary>
+	const std::uint8_t* recordData(const EntityRecord& record) const {
+		return data.data() + record.dataOffset;
+	}
+
+	/// <summary>
+	/// Appends a record, for example when a level is built by a tool.
+	/// </summary>
+	/// <param name="type - the factory type"></param>
+	/// <param name="group - the group the entity joins, or noStreamGroup"></param>
+	/// <param name="x, y - the position in world coordinates"></param>
+	/// <param name="bytes - extra data passed to the factory (optional)"></param>
+	/// <param name="size - the size of the extra data"></param>
+	void add(EntityType type, std::uint16_t group, float x, float y, const void* bytes = nullptr, std::uint16_t size = 0) {
+		records.push_back({ type, group, x, y, static_cast<std::uint32_t>(data.size()), size });
+		const std::uint8_t* b = static_cast<const std::uint8_t*>(bytes);
+		if (b)
+			data.insert(data.end(), b, b + size);
+		else
+			data.resize(data.size() + size);
+	}
+};
+
+/// <summary>
+/// The grid of cells stored in a stream file.
+/// </summary>
+struct StreamLayout {
+	// The side of a cell in world pixels.
+	int cellSize = 512;
+	int cellsX = 0, cellsY = 0;
+	// World position of the top left corner of cell (0, 0).
+	int originX = 0, originY = 0;
+	// Tiles along the side of a cell, or 0 if the file has no tiles.
+	int cellTiles = 0;
+};
+
+using EntityFactory = std::function<void(Entity& entity, const EntityRecord& record, const std::uint8_t* data)>;
+
+/// <summary>
+/// Marks an entity created by a WorldStreamer, so that the entity is forgotten by its cell when it is destroyed by the game.
+/// </summary>
+class StreamedComponent : public Component {
+	friend class WorldStreamer;
+private:
+	WorldStreamer* streamer = nullptr;
+	std::uint64_t cell = 0;
+	std::size_t slot = 0;
+public:
+	void onRemove() override;
+};
+
+/// <summary>
+/// Loads the cells of a large world around the camera and unloads the far ones.
+///
+/// The stream file starts with a header ("CRWS", version, StreamLayout), followed by a table with the offset and size of every cell,
+/// and the cells themselves: the entity records and, optionally, the tiles of the cell as 16-bit indices and one bit per tile for collisions.
+/// All values are little-endian on every host. The table is checked against the length of the file when it is opened, and damaged cells are loaded empty.
+///
+/// Cells are read and parsed on a background thread. sync must be called between world updates on the thread that runs the world:
+/// it requests the cells near the camera, evicts cells beyond the eviction radius by destroying their entities,
+/// and creates the entities of loaded cells with the registered factories, no more than the commit budget per call.
+/// The streamer must be destroyed before its world; the entities it has created stay in the world.
+/// </summary>
+class WorldStreamer {
+private:
+	struct TableEntry {
+		std::uint64_t offset;
+		std::uint32_t size;
+	};
+
+	enum class CellState { Requested, Committing, Resident };
+
+	struct Cell {
+		CellState state = CellState::Requested;
+		std::uint32_t generation = 0;
+		std::unique_ptr<CellBatch> batch;
+		std::size_t cursor = 0;
+		std::vector<Entity*> entities;
+	};
+
+	struct Request {
+		std::uint64_t key;
+		std::uint32_t generation;
+	};
+
+	struct Loaded {
+		std::uint64_t key;
+		std::uint32_t generation;
+		std::unique_ptr<CellBatch> batch;
+	};
+
+	World& world;
+	std::string path;
+	StreamLayout layout;
+	std::vector<TableEntry> table;
+	bool open = false;
+
+	std::vector<EntityFactory> factories;
+	TileMapComponent* tileMap = nullptr;
+	int loadRadius = 1, evictRadius = 2;
+	std::size_t commitBudget = 64;
+	std::uint32_t nextGeneration = 0;
+
+	std::unordered_map<std::uint64_t, Cell> cells;
+	std::vector<std::pair<int, std::uint64_t>> wanted;
+	std::vector<Loaded> arrived;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Request> requests;
+	std::vector<Loaded> loaded;
+	bool stopping = false;
+	std::thread loader;
+
+	static std::uint64_t key(int x, int y) {
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(y)) << 32) | static_cast<std::uint32_t>(x);
+	}
+
+	static int keyX(std::uint64_t k) { return static_cast<int>(static_cast<std::uint32_t>(k)); }
+	static int keyY(std::uint64_t k) { return static_cast<int>(static_cast<std::uint32_t>(k >> 32)); }
+
+	void loaderLoop();
+	bool readCell(std::ifstream& file, std::uint64_t k, CellBatch& batch) const;
+	void evict(Cell& cell, std::uint64_t k);
+	std::size_t commit(Cell& cell, std::uint64_t k, std::size_t budget);
+	void applyTiles(int cellX, int cellY, const CellBatch* batch);
+	void forget(std::uint64_t cell, std::size_t slot);
+
+	friend class StreamedComponent;
+public:
+	/// <summary>
+	/// Opens the stream file and starts the loader thread.
+	/// </summary>
+	/// <param name="world - the world the entities are created in"></param>
+	/// <param name="path - the path to the stream file"></param>
+	WorldStreamer(World& world, const char* path);
+
+	~WorldStreamer();
+
+	WorldStreamer(const WorldStreamer&) = delete;
+	WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+	/// <summary>
+	/// Returns true if the stream file has been opened and its header is valid.
+	/// </summary>
+	/// <returns></returns>
+	bool isOpen() const { return open; }
+
+	const StreamLayout& getLayout() const { return layout; }
+
+	/// <summary>
+	/// Sets the function that creates the components of entities of the specified type. Records of types without a factory are skipped.
+	/// </summary>
+	/// <param name="type - the type stored in the records"></param>
+	/// <param name="factory - the function; the entity already exists and joins the record's group after the call"></param>
+	void registerFactory(EntityType type, EntityFactory factory);
+
+	/// <summary>
+	/// Sets how far from the camera cells are kept, in cells. A cell is loaded when it is within loadCells of the camera's cell and evicted when it is further than evictCells.
+	/// </summary>
+	void setRadius(int loadCells, int evictCells);
+
+	/// <summary>
+	/// Sets the maximum number of entities created by one sync.
+	/// </summary>
+	void setCommitBudget(std::size_t entitiesPerSync) { commitBudget = entitiesPerSync; }
+
+	/// <summary>
+	/// Writes the tiles of loaded cells into the tile map and clears the tiles of evicted cells. The map must be placed at the origin of the layout.
+	/// </summary>
+	/// <param name="map - the tile map, or nullptr to stop"></param>
+	void feedTileMap(TileMapComponent* map) { tileMap = map; }
+
+	/// <summary>
+	/// Requests the cells near the camera, evicts the far ones and commits loaded entities within the budget. Must not be called while the manager is updating.
+	/// </summary>
+	void sync();
+
+	/// <summary>
+	/// Returns the number of cells whose entities have all been created.
+	/// </summary>
+	std::size_t residentCells() const;
+
+	/// <summary>
+	/// Returns the number of cells that are being loaded or committed.
+	/// </summary>
+	std::size_t pendingCells() const { return cells.size() - residentCells(); }
+
+	/// <summary>
+	/// Writes a stream file. Cells missing from the list are stored empty.
+	/// </summary>
+	/// <param name="path - the path to the file"></param>
+	/// <param name="layout - the grid; tiles are written if cellTiles is not 0"></param>
+	/// <param name="cells - the cells with their coordinates set"></param>
+	/// <returns></returns>
+	static bool save(const char* path, const StreamLayout& layout, const std::vector<CellBatch>& cells);
+};
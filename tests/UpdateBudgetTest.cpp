@@ -0,0 +1,79 @@
+// Checks that low priority updates deferred by one long frame catch up and then run every tick again.
+// Build it together with ECS.cpp, Memory.cpp and Telemetry.cpp, for example: g++ -std=c++17 -I.. UpdateBudgetTest.cpp ../ECS.cpp ../Memory.cpp ../Telemetry.cpp
+
+#include "../ECS.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+	bool slowFrame = true;
+
+	// Checks stay active in release builds, unlike assert.
+	bool check(bool condition, const char* message) {
+		if (!condition)
+			std::cout << "[UpdateBudgetTest] FAILED: " << message << std::endl;
+		return condition;
+	}
+
+	class LowPriorityComponent : public Component {
+	public:
+		int updates = 0;
+
+		LowPriorityComponent() {
+			updatePolicy = UpdatePolicy::every(1, UpdatePriority::Low);
+		}
+
+		void update() override {
+			++updates;
+			if (slowFrame)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	};
+}
+
+int main() {
+	Manager manager;
+	manager.setUpdateBudget(1.0f);
+
+	std::vector<LowPriorityComponent*> components;
+	for (int i = 0; i < 200; ++i)
+		components.push_back(&manager.addEntity().addComponent<LowPriorityComponent>());
+
+	// One frame takes far longer than the budget, so most of the updates are deferred.
+	manager.update();
+	manager.refresh();
+	slowFrame = false;
+
+	std::size_t overdue = 0;
+	for (auto* c : components)
+		overdue += c->isOverdue();
+	if (!check(manager.isOverBudget() && overdue > 0, "the slow frame did not defer any update"))
+		return 1;
+
+	// The backlog runs first and the updates that became due meanwhile follow a tick later.
+	for (int tick = 0; tick < 2; ++tick) {
+		manager.update();
+		manager.refresh();
+	}
+
+	// From then on every component is updated once per tick and none is left overdue.
+	for (int tick = 0; tick < 10; ++tick) {
+		std::vector<int> before;
+		for (auto* c : components)
+			before.push_back(c->updates);
+
+		manager.update();
+		manager.refresh();
+
+		if (!check(!manager.isOverBudget(), "the manager is still over budget after the backlog ran"))
+			return 1;
+		for (std::size_t i = 0; i < components.size(); ++i) {
+			if (!check(components[i]->updates == before[i] + 1, "a component was not updated exactly once in a tick")
+				|| !check(!components[i]->isOverdue(), "a component is still overdue"))
+				return 1;
+		}
+	}
+
+	return 0;
+}